@@ -1,5 +1,9 @@
+#include <unistd.h>
+
 #include <string>
+#include <vector>
 
+#include "batch_aligner.h"
 #include "sequence_batch.h"
 #include "sequence_graph.h"
 #include "utils.h"
@@ -8,23 +12,49 @@ int main(int argc, char *argv[]) {
   std::string sequence_graph_file_path;
   std::string sequence_file_path;
   int32_t start_vertex = 1;
-  if (argc != 4) {
+  int num_threads = 1;
+  int option;
+  while ((option = getopt(argc, argv, "t:")) != -1) {
+    if (option == 't') {
+      num_threads = atoi(optarg);
+    } else {
+      num_threads = 0;
+      break;
+    }
+  }
+  if (argc - optind != 3 || num_threads <= 0) {
     std::cerr << "Usage:\t" << argv[0]
-              << "\t1-based_start_vertex_id\tgraph_file\tread_file\n";
+              << "\t[-t num_threads]\t1-based_start_vertex_id\tgraph_file"
+                 "\tread_file\n";
     exit(-1);
   } else {
-    start_vertex = atoi(argv[1]);
-    sequence_graph_file_path = argv[2];
-    sequence_file_path = argv[3];
+    start_vertex = atoi(argv[optind]);
+    sequence_graph_file_path = argv[optind + 1];
+    sequence_file_path = argv[optind + 2];
   }
   uint32_t max_batch_size = 1000000;
-  sga::SequenceGraph<int32_t, int32_t, int32_t> sequence_graph;
+  typedef sga::SequenceGraph<int32_t, int32_t, int32_t> SequenceGraph;
+  SequenceGraph sequence_graph;
   sequence_graph.SetAlignmentParameters(1, 1, 1);
   sga::SequenceBatch sequence_batch(max_batch_size);
-  sequence_graph.LoadFromGfaFile(sequence_graph_file_path);
-  sequence_graph.GenerateCharLabeledGraph();
+  // The graph file can be either a GFA file or an index built by sga_index.
+  if (SequenceGraph::IsIndexFile(sequence_graph_file_path)) {
+    if (!sequence_graph.LoadIndex(sequence_graph_file_path)) {
+      exit(-1);
+    }
+  } else {
+    sequence_graph.LoadFromGfaFile(sequence_graph_file_path);
+    sequence_graph.GenerateCharLabeledGraph();
+    sequence_graph.GenerateCompressedRepresentation();
+  }
 
-  sequence_batch.InitializeLoading(sequence_file_path);
+  sga::BatchAligner<SequenceGraph> batch_aligner(sequence_graph, num_threads);
+  std::vector<int32_t> alignment_costs;
+  if (!sequence_batch.InitializeLoading(
+          sequence_file_path, /*load_asynchronously=*/true,
+          /*num_decompression_threads=*/num_threads)) {
+    exit(-1);
+  }
 
   uint32_t num_sequences = sequence_batch.LoadBatch();
   uint64_t num_total_sequences = 0;
@@ -32,9 +62,21 @@ int main(int argc, char *argv[]) {
   double mapping_start_real_time = sga::GetRealTime();
 
   while (num_sequences > 0) {
+    batch_aligner.AlignBatch(
+        sequence_batch,
+        [start_vertex](const SequenceGraph &graph,
+                       const sga::Sequence &sequence,
+                       SequenceGraph::Workspace &workspace) {
+          return graph.ForwardExtendUsingLinearGapPenaltyWithNavarroAlgorithm(
+              sequence, start_vertex, workspace);
+        },
+        alignment_costs);
+    // The costs are reported once the whole batch is aligned, so the lines of
+    // the worker threads do not interleave.
     for (uint32_t si = 0; si < num_sequences; ++si) {
-      sequence_graph.ForwardExtendUsingLinearGapPenaltyWithNavarroAlgorithm(
-          sequence_batch.GetSequence(si), start_vertex);
+      std::cerr << "Sequence length: "
+                << sequence_batch.GetSequence(si).GetLength()
+                << ", alignment cost:" << alignment_costs[si] << std::endl;
     }
     num_total_sequences += num_sequences;
     num_sequences = sequence_batch.LoadBatch();
@@ -42,7 +84,11 @@ int main(int argc, char *argv[]) {
 
   std::cerr << "Extend " << num_total_sequences << " sequences in "
             << sga::GetRealTime() - mapping_start_real_time
-            << "s, starting from vertex " << start_vertex << std::endl;
+            << "s with " << num_threads << " threads, starting from vertex "
+            << start_vertex << std::endl;
+
+  std::cerr << "Waited " << sequence_batch.GetPrefetchWaitTime()
+            << "s for the prefetched sequence batches" << std::endl;
 
   sequence_batch.FinalizeLoading();
 }
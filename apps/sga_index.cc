@@ -0,0 +1,27 @@
+#include <string>
+
+#include "sequence_graph.h"
+#include "utils.h"
+
+int main(int argc, char *argv[]) {
+  std::string sequence_graph_file_path;
+  std::string index_file_path;
+  if (argc != 3) {
+    std::cerr << "Usage:\t" << argv[0] << "\tgraph_file\tindex_file\n";
+    exit(-1);
+  } else {
+    sequence_graph_file_path = argv[1];
+    index_file_path = argv[2];
+  }
+  double index_start_real_time = sga::GetRealTime();
+  sga::SequenceGraph<int32_t, int32_t, int32_t> sequence_graph;
+  sequence_graph.LoadFromGfaFile(sequence_graph_file_path);
+  sequence_graph.GenerateCharLabeledGraph();
+  sequence_graph.GenerateCompressedRepresentation();
+  if (!sequence_graph.SaveIndex(index_file_path)) {
+    exit(-1);
+  }
+
+  std::cerr << "Built index " << index_file_path << " in "
+            << sga::GetRealTime() - index_start_real_time << "s" << std::endl;
+}
@@ -53,6 +53,28 @@ static void BM_AlignUsingLinearGapPenaltyWithNavarroAlgorithm(
   }
 }
 
+static void BM_AlignUsingLinearGapPenaltyWithMyersAlgorithm(
+    benchmark::State& state) {
+  const uint32_t num_sequences = sequence_batch.GetNumLoadedSequences();
+  for (auto _ : state) {
+    for (uint32_t si = 0; si < num_sequences; ++si) {
+      sequence_graph.AlignUsingLinearGapPenaltyWithMyersAlgorithm(
+          sequence_batch.GetSequence(si));
+    }
+  }
+}
+
+static void BM_AlignUsingLinearGapPenaltyOnCompactedGraph(
+    benchmark::State& state) {
+  const uint32_t num_sequences = sequence_batch.GetNumLoadedSequences();
+  for (auto _ : state) {
+    for (uint32_t si = 0; si < num_sequences; ++si) {
+      sequence_graph.AlignUsingLinearGapPenaltyOnCompactedGraph(
+          sequence_batch.GetSequence(si));
+    }
+  }
+}
+
 static void BM_AlignUsingLinearGapPenaltyWithDijkstraAlgorithm(
     benchmark::State& state) {
   const uint32_t num_sequences = sequence_batch.GetNumLoadedSequences();
@@ -68,6 +90,12 @@ BENCHMARK(BM_AlignUsingLinearGapPenalty)->Setup(DoSetup)->Teardown(DoTeardown);
 BENCHMARK(BM_AlignUsingLinearGapPenaltyWithNavarroAlgorithm)
     ->Setup(DoSetup)
     ->Teardown(DoTeardown);
+BENCHMARK(BM_AlignUsingLinearGapPenaltyWithMyersAlgorithm)
+    ->Setup(DoSetup)
+    ->Teardown(DoTeardown);
+BENCHMARK(BM_AlignUsingLinearGapPenaltyOnCompactedGraph)
+    ->Setup(DoSetup)
+    ->Teardown(DoTeardown);
 BENCHMARK(BM_AlignUsingLinearGapPenaltyWithDijkstraAlgorithm)
     ->Setup(DoSetup)
     ->Teardown(DoTeardown);
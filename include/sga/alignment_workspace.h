@@ -0,0 +1,123 @@
+#ifndef SGA_ALIGNMENTWORKSPACE_H_
+#define SGA_ALIGNMENTWORKSPACE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bucket_queue.h"
+#include "distance_table.h"
+
+namespace sga {
+
+template <class GraphSizeType, class QueryLengthType, class ScoreType>
+class SequenceGraph;
+
+template <class GraphSizeType = int32_t, class QueryLengthType = int16_t,
+          class ScoreType = int16_t>
+struct VertexWithDistanceForDijkstra {
+  GraphSizeType graph_vertex_id;
+  QueryLengthType query_index;
+  ScoreType distance;
+  bool is_reverse_complementary;
+};
+
+// Order the cells with the same distance and query index for the Dijkstra
+// aligner: the ones with smaller vertex id first, then the reverse
+// complementary ones. Returns true if v1 should be popped after v2.
+template <class GraphSizeType = int32_t, class QueryLengthType = int16_t,
+          class ScoreType = int16_t>
+struct CompareVerticesWithSameKeysForDijkstra {
+  bool operator()(const VertexWithDistanceForDijkstra<
+                      GraphSizeType, QueryLengthType, ScoreType> &v1,
+                  const VertexWithDistanceForDijkstra<
+                      GraphSizeType, QueryLengthType, ScoreType> &v2) const {
+    if (v1.graph_vertex_id != v2.graph_vertex_id) {
+      return v1.graph_vertex_id > v2.graph_vertex_id;
+    }
+    return !v1.is_reverse_complementary && v2.is_reverse_complementary;
+  }
+};
+
+// The scratch memory used by the alignment kernels of SequenceGraph. The graph
+// itself is not modified by the kernels, so one graph can be shared by many
+// threads as long as each thread passes its own workspace to the Align* and
+// Extend* calls. The buffers only grow, so a workspace reused across reads
+// makes the alignments allocation free once it is warm.
+template <class GraphSizeType = int32_t, class QueryLengthType = int16_t,
+          class ScoreType = int16_t>
+class AlignmentWorkspace {
+ public:
+  AlignmentWorkspace() {}
+  ~AlignmentWorkspace() {}
+
+ protected:
+  friend class SequenceGraph<GraphSizeType, QueryLengthType, ScoreType>;
+
+  // The cells are keyed by distance, then by query index, then ordered by
+  // vertex and strand.
+  typedef TwoLevelBucketQueue<
+      VertexWithDistanceForDijkstra<GraphSizeType, QueryLengthType, ScoreType>,
+      ScoreType, QueryLengthType,
+      CompareVerticesWithSameKeysForDijkstra<GraphSizeType, QueryLengthType,
+                                             ScoreType>>
+      DijkstraQueue;
+
+  // The mismatch mask of the current row, one bit per vertex.
+  std::vector<uint64_t> mismatch_mask_;
+
+  // For RECOMB work
+  std::vector<ScoreType> previous_layer_;
+  std::vector<ScoreType> current_layer_;
+  std::vector<GraphSizeType> previous_order_;
+  std::vector<GraphSizeType> initialized_order_;
+  std::vector<GraphSizeType> current_order_;
+  // A vertex is visited in the current row if it is stamped with its epoch.
+  std::vector<uint32_t> visited_epochs_;
+  uint32_t visited_epoch_ = 0;
+  // The offsets of the buckets of the counting sort by costs.
+  std::vector<GraphSizeType> distance_bucket_offsets_;
+  // A FIFO of the vertices updated by insertions, with its head at
+  // updated_neighbors_head_.
+  std::vector<GraphSizeType> updated_neighbors_;
+  size_t updated_neighbors_head_ = 0;
+
+  // For Navarro's algorithm
+  std::vector<QueryLengthType> navarro_previous_layer_;
+  std::vector<QueryLengthType> navarro_current_layer_;
+  BucketQueue<GraphSizeType, QueryLengthType> propagation_queue_;
+  // The vertices whose cells are active, for the active set aligner.
+  std::vector<GraphSizeType> previous_active_vertices_;
+  std::vector<GraphSizeType> current_active_vertices_;
+  // The row of each word of mismatch_mask_, or -1, for the active set aligner
+  // which only computes the words of its active cells.
+  std::vector<int32_t> mismatch_mask_rows_;
+
+  // For Myers' algorithm
+  std::string myers_query_;
+  std::vector<uint64_t> myers_match_masks_;
+  std::vector<uint64_t> myers_columns_;
+  std::vector<uint8_t> myers_column_states_;
+  std::vector<uint64_t> myers_candidate_column_;
+  std::vector<GraphSizeType> myers_worklist_;
+  std::vector<uint8_t> myers_is_in_worklist_;
+
+  // For the aligner on the compacted graph
+  std::string compacted_graph_query_;
+  std::string compacted_graph_label_;
+  std::vector<ScoreType> compacted_graph_source_column_;
+  std::vector<ScoreType> compacted_graph_entry_columns_;
+  std::vector<size_t> compacted_graph_entry_num_active_rows_;
+  std::vector<ScoreType> compacted_graph_previous_column_;
+  std::vector<ScoreType> compacted_graph_current_column_;
+  std::vector<GraphSizeType> compacted_graph_order_;
+  std::vector<uint8_t> compacted_graph_is_queued_;
+
+  // For Dijkstra's algorithm
+  DijkstraQueue dijkstra_queue_;
+  DistanceTable<ScoreType> dijkstra_distances_;
+};
+
+}  // namespace sga
+
+#endif  // SGA_ALIGNMENTWORKSPACE_H_
@@ -0,0 +1,232 @@
+#ifndef SGA_BATCHALIGNER_H_
+#define SGA_BATCHALIGNER_H_
+
+#include <assert.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "sequence.h"
+#include "sequence_batch.h"
+
+namespace sga {
+
+// Align the sequences of a batch against one shared graph with a pool of
+// threads. The threads live as long as the aligner and wait for each batch,
+// and each one owns an alignment workspace, which is kept across batches. The
+// calling thread aligns sequences too. The sequences are dealt to the threads
+// longest first, since the alignment cost grows with the sequence length, and
+// a thread that runs out of sequences steals the shortest ones left to another
+// thread.
+template <class GraphType>
+class BatchAligner {
+ public:
+  typedef typename GraphType::Workspace Workspace;
+
+  BatchAligner(const GraphType &sequence_graph, const int num_threads)
+      : sequence_graph_(sequence_graph),
+        num_threads_(0),
+        batch_generation_(0),
+        num_busy_threads_(0),
+        stop_threads_(false) {
+    SetNumThreads(num_threads);
+  }
+
+  ~BatchAligner() { StopThreads(); }
+
+  int GetNumThreads() const { return num_threads_; }
+
+  void SetNumThreads(const int num_threads) {
+    assert(num_threads > 0);
+    StopThreads();
+    num_threads_ = num_threads;
+    workspaces_.resize(num_threads_);
+    work_queues_ = std::vector<WorkQueue>(num_threads_);
+    StartThreads();
+  }
+
+  // Align the sequences loaded in the batch. align_function is called as
+  // align_function(sequence_graph, sequence, workspace) and returns the result
+  // of one sequence. The results are stored in the order of the sequences in
+  // the batch, each one written by the thread aligning the sequence.
+  template <class ResultType, class AlignFunction>
+  void AlignBatch(const SequenceBatch &sequence_batch,
+                  const AlignFunction &align_function,
+                  std::vector<ResultType> &results) {
+    static_assert(!std::is_same<ResultType, bool>::value,
+                  "The elements of std::vector<bool> cannot be written by "
+                  "different threads.");
+    const uint32_t num_sequences = sequence_batch.GetNumLoadedSequences();
+    results.resize(num_sequences);
+    if (num_sequences == 0) {
+      return;
+    }
+
+    std::vector<uint32_t> sequence_indices(num_sequences);
+    for (uint32_t si = 0; si < num_sequences; ++si) {
+      sequence_indices[si] = si;
+    }
+    std::stable_sort(sequence_indices.begin(), sequence_indices.end(),
+                     [&sequence_batch](const uint32_t a, const uint32_t b) {
+                       return sequence_batch.GetSequence(a).GetLength() >
+                              sequence_batch.GetSequence(b).GetLength();
+                     });
+
+    const int num_workers =
+        (int)std::min<uint32_t>((uint32_t)num_threads_, num_sequences);
+    for (WorkQueue &work_queue : work_queues_) {
+      work_queue.sequence_indices.clear();
+    }
+    for (uint32_t i = 0; i < num_sequences; ++i) {
+      work_queues_[i % num_workers].sequence_indices.push_back(
+          sequence_indices[i]);
+    }
+
+    if (num_workers == 1) {
+      RunWorker(0, sequence_batch, align_function, results);
+      return;
+    }
+
+    batch_function_ = [&](const int worker_id) {
+      RunWorker(worker_id, sequence_batch, align_function, results);
+    };
+    {
+      std::lock_guard<std::mutex> lock(batch_mutex_);
+      num_busy_threads_ = threads_.size();
+      ++batch_generation_;
+    }
+    batch_start_.notify_all();
+    batch_function_(/*worker_id=*/0);
+    {
+      std::unique_lock<std::mutex> lock(batch_mutex_);
+      batch_done_.wait(lock, [this] { return num_busy_threads_ == 0; });
+    }
+    batch_function_ = nullptr;
+  }
+
+ protected:
+  struct WorkQueue {
+    std::mutex mutex;
+    // Sorted by decreasing sequence length. The owner pops from the front and
+    // the other threads steal from the back.
+    std::deque<uint32_t> sequence_indices;
+  };
+
+  static bool PopFront(WorkQueue &work_queue, uint32_t &sequence_index) {
+    std::lock_guard<std::mutex> lock(work_queue.mutex);
+    if (work_queue.sequence_indices.empty()) {
+      return false;
+    }
+    sequence_index = work_queue.sequence_indices.front();
+    work_queue.sequence_indices.pop_front();
+    return true;
+  }
+
+  static bool PopBack(WorkQueue &work_queue, uint32_t &sequence_index) {
+    std::lock_guard<std::mutex> lock(work_queue.mutex);
+    if (work_queue.sequence_indices.empty()) {
+      return false;
+    }
+    sequence_index = work_queue.sequence_indices.back();
+    work_queue.sequence_indices.pop_back();
+    return true;
+  }
+
+  // The calling thread is worker 0, so only the other workers get a thread.
+  void StartThreads() {
+    stop_threads_ = false;
+    batch_generation_ = 0;
+    threads_.reserve(num_threads_ - 1);
+    for (int worker_id = 1; worker_id < num_threads_; ++worker_id) {
+      threads_.emplace_back(&BatchAligner::RunThread, this, worker_id);
+    }
+  }
+
+  void StopThreads() {
+    if (threads_.empty()) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(batch_mutex_);
+      stop_threads_ = true;
+    }
+    batch_start_.notify_all();
+    for (std::thread &thread : threads_) {
+      thread.join();
+    }
+    threads_.clear();
+  }
+
+  // Wait for each batch, signalled by a new generation, and work on it.
+  void RunThread(const int worker_id) {
+    uint64_t generation = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(batch_mutex_);
+        batch_start_.wait(lock, [&] {
+          return stop_threads_ || batch_generation_ != generation;
+        });
+        if (stop_threads_) {
+          return;
+        }
+        generation = batch_generation_;
+      }
+      batch_function_(worker_id);
+      {
+        std::lock_guard<std::mutex> lock(batch_mutex_);
+        --num_busy_threads_;
+      }
+      batch_done_.notify_one();
+    }
+  }
+
+  template <class ResultType, class AlignFunction>
+  void RunWorker(const int worker_id, const SequenceBatch &sequence_batch,
+                 const AlignFunction &align_function,
+                 std::vector<ResultType> &results) {
+    Workspace &workspace = workspaces_[worker_id];
+    uint32_t sequence_index = 0;
+    while (true) {
+      bool has_work = PopFront(work_queues_[worker_id], sequence_index);
+      // No work is added to the queues during a batch, so once all of them
+      // are empty the worker is done.
+      for (int i = 1; !has_work && i < num_threads_; ++i) {
+        has_work = PopBack(work_queues_[(worker_id + i) % num_threads_],
+                           sequence_index);
+      }
+      if (!has_work) {
+        break;
+      }
+      results[sequence_index] =
+          align_function(sequence_graph_,
+                         sequence_batch.GetSequence(sequence_index), workspace);
+    }
+  }
+
+  const GraphType &sequence_graph_;
+  int num_threads_;
+  std::vector<Workspace> workspaces_;
+  std::vector<WorkQueue> work_queues_;
+  // The work of the current batch for a given worker.
+  std::function<void(int)> batch_function_;
+  // The threads of the workers other than worker 0. Each batch bumps the
+  // generation to start them and waits until none is busy.
+  std::vector<std::thread> threads_;
+  std::mutex batch_mutex_;
+  std::condition_variable batch_start_;
+  std::condition_variable batch_done_;
+  uint64_t batch_generation_;
+  size_t num_busy_threads_;
+  bool stop_threads_;
+};
+
+}  // namespace sga
+
+#endif  // SGA_BATCHALIGNER_H_
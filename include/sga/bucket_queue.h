@@ -0,0 +1,218 @@
+#ifndef SGA_BUCKETQUEUE_H_
+#define SGA_BUCKETQUEUE_H_
+
+#include <assert.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sga {
+
+// A bucket queue (Dial's algorithm) for values with small non-negative
+// integer keys. The buckets are indexed by the key directly and values with
+// the same key are popped in FIFO order. Popping is amortized O(1) as long as
+// the keys pushed are mostly not smaller than the key last popped, which is
+// the case for shortest path searches with non-negative edge weights. The
+// buckets keep their capacity after Clear so the queue can be reused without
+// allocation.
+template <class ValueType, class KeyType>
+class BucketQueue {
+ public:
+  BucketQueue()
+      : min_key_(SIZE_MAX), max_key_(0), current_position_(0), size_(0) {}
+  ~BucketQueue() {}
+
+  void Clear() {
+    for (size_t key = min_key_; key <= max_key_ && key < buckets_.size();
+         ++key) {
+      buckets_[key].clear();
+    }
+    min_key_ = SIZE_MAX;
+    max_key_ = 0;
+    current_position_ = 0;
+    size_ = 0;
+  }
+
+  bool Empty() const { return size_ == 0; }
+
+  size_t GetSize() const { return size_; }
+
+  void Push(const KeyType key, const ValueType &value) {
+    assert(key >= 0);
+    const size_t bucket_index = key;
+    if (bucket_index >= buckets_.size()) {
+      buckets_.resize(bucket_index + 1);
+    }
+
+    if (bucket_index < min_key_) {
+      // Drop the values already popped from the current min bucket, so that
+      // they will not be popped again after we move back to the new key.
+      if (min_key_ < buckets_.size()) {
+        std::vector<ValueType> &bucket = buckets_[min_key_];
+        bucket.erase(bucket.begin(), bucket.begin() + current_position_);
+      }
+      min_key_ = bucket_index;
+      current_position_ = 0;
+    }
+
+    if (bucket_index > max_key_) {
+      max_key_ = bucket_index;
+    }
+
+    buckets_[bucket_index].push_back(value);
+    ++size_;
+  }
+
+  // Pop a value with the min key and return the key. The queue must not be
+  // empty.
+  ValueType Pop(KeyType &key) {
+    assert(!Empty());
+    while (current_position_ == buckets_[min_key_].size()) {
+      buckets_[min_key_].clear();
+      ++min_key_;
+      current_position_ = 0;
+    }
+    --size_;
+    key = (KeyType)min_key_;
+    return buckets_[min_key_][current_position_++];
+  }
+
+ protected:
+  std::vector<std::vector<ValueType>> buckets_;
+  // All the non-empty buckets are in [min_key_, max_key_].
+  size_t min_key_;
+  size_t max_key_;
+  // Number of values already popped from the min bucket.
+  size_t current_position_;
+  size_t size_;
+};
+
+// A bucket queue for values with two small non-negative integer keys, popped
+// by increasing key and, among the values sharing the key, by decreasing
+// secondary key. Each bucket of the key is split into buckets indexed by the
+// secondary key, and each of those is a binary heap ordered by compare, so
+// only the values sharing both keys are compared with each other. As for
+// std::priority_queue, compare(a, b) returns true if a should be popped after
+// b. Values can be pushed with a key smaller than the current min key.
+template <class ValueType, class KeyType, class SecondaryKeyType,
+          class Compare>
+class TwoLevelBucketQueue {
+ public:
+  explicit TwoLevelBucketQueue(const Compare &compare = Compare())
+      : compare_(compare), min_key_(SIZE_MAX), max_key_(0), size_(0) {}
+  ~TwoLevelBucketQueue() {}
+
+  void Clear() {
+    for (size_t key = min_key_; key <= max_key_ && key < buckets_.size();
+         ++key) {
+      buckets_[key].Clear();
+    }
+    min_key_ = SIZE_MAX;
+    max_key_ = 0;
+    size_ = 0;
+  }
+
+  bool Empty() const { return size_ == 0; }
+
+  size_t GetSize() const { return size_; }
+
+  void Push(const KeyType key, const SecondaryKeyType secondary_key,
+            const ValueType &value) {
+    assert(key >= 0);
+    assert(secondary_key >= 0);
+    const size_t bucket_index = key;
+    if (bucket_index >= buckets_.size()) {
+      buckets_.resize(bucket_index + 1);
+    }
+
+    if (bucket_index < min_key_) {
+      min_key_ = bucket_index;
+    }
+
+    if (bucket_index > max_key_) {
+      max_key_ = bucket_index;
+    }
+
+    buckets_[bucket_index].Push(secondary_key, value, compare_);
+    ++size_;
+  }
+
+  // Pop the first value with the min key and the max secondary key among the
+  // values with the min key, and return the key. The queue must not be empty.
+  ValueType Pop(KeyType &key) {
+    assert(!Empty());
+    while (buckets_[min_key_].size == 0) {
+      ++min_key_;
+    }
+    --size_;
+    key = (KeyType)min_key_;
+    return buckets_[min_key_].Pop(compare_);
+  }
+
+ protected:
+  struct Bucket {
+    std::vector<std::vector<ValueType>> secondary_buckets;
+    // All the non-empty secondary buckets are in
+    // [min_secondary_key, max_secondary_key].
+    size_t min_secondary_key = SIZE_MAX;
+    size_t max_secondary_key = 0;
+    size_t size = 0;
+
+    void Clear() {
+      for (size_t secondary_key = min_secondary_key;
+           secondary_key <= max_secondary_key &&
+           secondary_key < secondary_buckets.size();
+           ++secondary_key) {
+        secondary_buckets[secondary_key].clear();
+      }
+      min_secondary_key = SIZE_MAX;
+      max_secondary_key = 0;
+      size = 0;
+    }
+
+    void Push(const size_t secondary_key, const ValueType &value,
+              const Compare &compare) {
+      if (secondary_key >= secondary_buckets.size()) {
+        secondary_buckets.resize(secondary_key + 1);
+      }
+      min_secondary_key = std::min(min_secondary_key, secondary_key);
+      max_secondary_key = std::max(max_secondary_key, secondary_key);
+      std::vector<ValueType> &secondary_bucket =
+          secondary_buckets[secondary_key];
+      secondary_bucket.push_back(value);
+      std::push_heap(secondary_bucket.begin(), secondary_bucket.end(),
+                     compare);
+      ++size;
+    }
+
+    ValueType Pop(const Compare &compare) {
+      while (secondary_buckets[max_secondary_key].empty()) {
+        --max_secondary_key;
+      }
+      std::vector<ValueType> &secondary_bucket =
+          secondary_buckets[max_secondary_key];
+      std::pop_heap(secondary_bucket.begin(), secondary_bucket.end(),
+                    compare);
+      const ValueType value = secondary_bucket.back();
+      secondary_bucket.pop_back();
+      if (--size == 0) {
+        min_secondary_key = SIZE_MAX;
+        max_secondary_key = 0;
+      }
+      return value;
+    }
+  };
+
+  Compare compare_;
+  std::vector<Bucket> buckets_;
+  // All the non-empty buckets are in [min_key_, max_key_].
+  size_t min_key_;
+  size_t max_key_;
+  size_t size_;
+};
+
+}  // namespace sga
+
+#endif  // SGA_BUCKETQUEUE_H_
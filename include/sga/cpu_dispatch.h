@@ -0,0 +1,42 @@
+#ifndef SGA_CPUDISPATCH_H_
+#define SGA_CPUDISPATCH_H_
+
+// The mismatch mask expansion of the packed labels is also compiled for AVX2
+// with a target attribute and picked at runtime when the CPU supports it, so
+// a binary built without architecture flags still uses it. Only GCC and Clang
+// on x86 have the attribute, other builds always use the baseline expansion.
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define SGA_HAS_CPU_DISPATCH 1
+#define SGA_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SGA_HAS_CPU_DISPATCH 0
+#endif
+
+namespace sga {
+
+// Ordered from the narrowest to the widest vectors.
+enum class InstructionSet { kBaseline, kAvx2 };
+
+inline InstructionSet GetSupportedInstructionSet() {
+#if SGA_HAS_CPU_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return InstructionSet::kAvx2;
+  }
+#endif
+  return InstructionSet::kBaseline;
+}
+
+inline const char *GetInstructionSetName(const InstructionSet instruction_set) {
+  switch (instruction_set) {
+    case InstructionSet::kAvx2:
+      return "AVX2";
+    default:
+      return "baseline";
+  }
+}
+
+}  // namespace sga
+
+#endif  // SGA_CPUDISPATCH_H_
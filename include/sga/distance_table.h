@@ -0,0 +1,122 @@
+#ifndef SGA_DISTANCETABLE_H_
+#define SGA_DISTANCETABLE_H_
+
+#include <assert.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace sga {
+
+// An open addressing hash table with linear probing that maps 64-bit cell keys
+// to distances. Every slot remembers the epoch in which it was written and the
+// slots written in previous epochs are treated as empty, so Clear is O(1) and
+// the memory of the table is reused across alignments. The table doubles its
+// capacity when it is 70% full.
+template <class ValueType>
+class DistanceTable {
+ public:
+  DistanceTable() : epoch_(1), size_(0), mask_(0) {}
+  ~DistanceTable() {}
+
+  void Clear() {
+    size_ = 0;
+    ++epoch_;
+    if (epoch_ == 0) {
+      // The epoch wrapped around. Reset all the slots so that none of them
+      // looks written in the new epoch.
+      for (Slot &slot : slots_) {
+        slot.epoch = 0;
+      }
+      epoch_ = 1;
+    }
+  }
+
+  uint64_t GetSize() const { return size_; }
+
+  uint64_t GetCapacity() const { return slots_.size(); }
+
+  // Return the distance stored for the key, or nullptr if there is none.
+  const ValueType *Find(const uint64_t key) const {
+    if (slots_.empty()) {
+      return nullptr;
+    }
+    uint64_t slot_index = Hash(key) & mask_;
+    while (slots_[slot_index].epoch == epoch_) {
+      if (slots_[slot_index].key == key) {
+        return &slots_[slot_index].value;
+      }
+      slot_index = (slot_index + 1) & mask_;
+    }
+    return nullptr;
+  }
+
+  // Return the distance stored for the key, inserting a slot for it if there
+  // is none. is_inserted tells whether the slot is new, in which case the
+  // returned distance is not initialized. The reference is valid until the
+  // next insertion.
+  ValueType &FindOrInsert(const uint64_t key, bool &is_inserted) {
+    if ((size_ + 1) * 10 > slots_.size() * 7) {
+      Grow();
+    }
+
+    uint64_t slot_index = Hash(key) & mask_;
+    while (slots_[slot_index].epoch == epoch_) {
+      if (slots_[slot_index].key == key) {
+        is_inserted = false;
+        return slots_[slot_index].value;
+      }
+      slot_index = (slot_index + 1) & mask_;
+    }
+
+    ++size_;
+    is_inserted = true;
+    slots_[slot_index].key = key;
+    slots_[slot_index].epoch = epoch_;
+    return slots_[slot_index].value;
+  }
+
+ protected:
+  struct Slot {
+    uint64_t key;
+    uint32_t epoch;
+    ValueType value;
+  };
+
+  static uint64_t Hash(uint64_t key) {
+    // The finalizer of MurmurHash3.
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+  }
+
+  void Grow() {
+    const uint64_t new_capacity =
+        slots_.empty() ? (uint64_t)1 << 16 : slots_.size() << 1;
+    std::vector<Slot> new_slots(new_capacity, Slot{0, 0, ValueType()});
+    const uint64_t new_mask = new_capacity - 1;
+    for (const Slot &slot : slots_) {
+      if (slot.epoch == epoch_) {
+        uint64_t slot_index = Hash(slot.key) & new_mask;
+        while (new_slots[slot_index].epoch == epoch_) {
+          slot_index = (slot_index + 1) & new_mask;
+        }
+        new_slots[slot_index] = slot;
+      }
+    }
+    slots_.swap(new_slots);
+    mask_ = new_mask;
+  }
+
+  std::vector<Slot> slots_;
+  uint32_t epoch_;
+  uint64_t size_;
+  uint64_t mask_;
+};
+
+}  // namespace sga
+
+#endif  // SGA_DISTANCETABLE_H_
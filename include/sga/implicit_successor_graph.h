@@ -0,0 +1,187 @@
+#ifndef SGA_IMPLICITSUCCESSORGRAPH_H_
+#define SGA_IMPLICITSUCCESSORGRAPH_H_
+
+#include <assert.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sga {
+
+// An immutable view of the char labeled graph where the edge from a vertex to
+// the next id, which is the next char of its unitig once the vertices are
+// renumbered, is implicit and only marked by a bit. The other edges, e.g. the
+// ones leaving a unitig, are explicit and stored in compressed sparse row
+// format over the vertices having any, which are found by rank. Most vertices
+// of a char labeled graph only have the implicit edge, so the graph takes
+// about 2 bits per vertex plus its branching edges, instead of one offset and
+// one neighbor per vertex. The view does not own the arrays.
+template <class GraphSizeType = int32_t>
+struct ImplicitSuccessorGraph {
+  GraphSizeType num_vertices = 0;
+  GraphSizeType num_edges = 0;
+  // Bit v is set if v -> v + 1 is an edge.
+  const uint64_t *next_edge_bits = nullptr;
+  // Bit v is set if v has explicit out-edges.
+  const uint64_t *explicit_edge_bits = nullptr;
+  // The number of bits set in explicit_edge_bits before each word.
+  const GraphSizeType *explicit_edge_ranks = nullptr;
+  // The explicit out-neighbors of the vertex with rank r are
+  // explicit_neighbors[explicit_offsets[r]] to
+  // explicit_neighbors[explicit_offsets[r + 1] - 1].
+  const GraphSizeType *explicit_offsets = nullptr;
+  const GraphSizeType *explicit_neighbors = nullptr;
+  const char *labels = nullptr;
+
+  // Visits the implicit out-neighbor first, if any, then the explicit ones.
+  class NeighborIterator {
+   public:
+    NeighborIterator(const GraphSizeType next_vertex,
+                     const bool has_next_vertex,
+                     const GraphSizeType *explicit_neighbor)
+        : next_vertex_(next_vertex),
+          has_next_vertex_(has_next_vertex),
+          explicit_neighbor_(explicit_neighbor) {}
+
+    GraphSizeType operator*() const {
+      return has_next_vertex_ ? next_vertex_ : *explicit_neighbor_;
+    }
+
+    NeighborIterator &operator++() {
+      if (has_next_vertex_) {
+        has_next_vertex_ = false;
+      } else {
+        ++explicit_neighbor_;
+      }
+      return *this;
+    }
+
+    bool operator!=(const NeighborIterator &other) const {
+      return has_next_vertex_ != other.has_next_vertex_ ||
+             explicit_neighbor_ != other.explicit_neighbor_;
+    }
+
+   protected:
+    GraphSizeType next_vertex_;
+    bool has_next_vertex_;
+    const GraphSizeType *explicit_neighbor_;
+  };
+
+  struct NeighborRange {
+    NeighborIterator first;
+    NeighborIterator last;
+    NeighborIterator begin() const { return first; }
+    NeighborIterator end() const { return last; }
+  };
+
+  static size_t GetNumBitWords(const GraphSizeType num_vertices) {
+    // One more bit is kept so that the virtual start vertex (with id
+    // num_vertices) used by the Dijkstra aligner has no neighbors.
+    return ((size_t)num_vertices + 1 + 63) / 64;
+  }
+
+  GraphSizeType GetNumEdges() const { return num_edges; }
+
+  GraphSizeType GetNumExplicitVertices() const {
+    const size_t num_words = GetNumBitWords(num_vertices);
+    return explicit_edge_ranks[num_words - 1] +
+           __builtin_popcountll(explicit_edge_bits[num_words - 1]);
+  }
+
+  bool HasNextEdge(const GraphSizeType vertex) const {
+    return (next_edge_bits[vertex >> 6] >> (vertex & 63)) & 1;
+  }
+
+  bool HasExplicitEdges(const GraphSizeType vertex) const {
+    return (explicit_edge_bits[vertex >> 6] >> (vertex & 63)) & 1;
+  }
+
+  // The number of vertices before the given one having explicit out-edges.
+  GraphSizeType GetExplicitEdgeRank(const GraphSizeType vertex) const {
+    const uint64_t lower_bits =
+        explicit_edge_bits[vertex >> 6] & (((uint64_t)1 << (vertex & 63)) - 1);
+    return explicit_edge_ranks[vertex >> 6] + __builtin_popcountll(lower_bits);
+  }
+
+  NeighborRange GetNeighbors(const GraphSizeType vertex) const {
+    const GraphSizeType *first_explicit_neighbor = explicit_neighbors;
+    const GraphSizeType *last_explicit_neighbor = explicit_neighbors;
+    if (HasExplicitEdges(vertex)) {
+      const GraphSizeType rank = GetExplicitEdgeRank(vertex);
+      first_explicit_neighbor += explicit_offsets[rank];
+      last_explicit_neighbor += explicit_offsets[rank + 1];
+    }
+    return {NeighborIterator(vertex + 1, HasNextEdge(vertex),
+                             first_explicit_neighbor),
+            NeighborIterator(vertex + 1, false, last_explicit_neighbor)};
+  }
+};
+
+// The arrays of an ImplicitSuccessorGraph built from a graph in any format
+// with num_vertices, labels and GetNeighbors.
+template <class GraphSizeType = int32_t>
+class ImplicitSuccessorGraphArrays {
+ public:
+  template <class GraphType>
+  void Build(const GraphType &graph) {
+    const size_t num_words =
+        ImplicitSuccessorGraph<GraphSizeType>::GetNumBitWords(
+            graph.num_vertices);
+    next_edge_bits_.assign(num_words, 0);
+    explicit_edge_bits_.assign(num_words, 0);
+    explicit_edge_ranks_.assign(num_words, 0);
+    explicit_offsets_.assign(1, 0);
+    explicit_neighbors_.clear();
+    num_edges_ = 0;
+    for (GraphSizeType vertex = 0; vertex < graph.num_vertices; ++vertex) {
+      bool has_next_edge = false;
+      for (const GraphSizeType neighbor : graph.GetNeighbors(vertex)) {
+        ++num_edges_;
+        if (neighbor == vertex + 1 && !has_next_edge) {
+          has_next_edge = true;
+          next_edge_bits_[vertex >> 6] |= (uint64_t)1 << (vertex & 63);
+        } else {
+          explicit_neighbors_.push_back(neighbor);
+        }
+      }
+      if ((GraphSizeType)explicit_neighbors_.size() !=
+          explicit_offsets_.back()) {
+        explicit_edge_bits_[vertex >> 6] |= (uint64_t)1 << (vertex & 63);
+        explicit_offsets_.push_back(explicit_neighbors_.size());
+      }
+    }
+    for (size_t wi = 1; wi < num_words; ++wi) {
+      explicit_edge_ranks_[wi] =
+          explicit_edge_ranks_[wi - 1] +
+          __builtin_popcountll(explicit_edge_bits_[wi - 1]);
+    }
+    std::vector<GraphSizeType>(explicit_neighbors_).swap(explicit_neighbors_);
+  }
+
+  ImplicitSuccessorGraph<GraphSizeType> GetView(
+      const GraphSizeType num_vertices, const char *labels) const {
+    ImplicitSuccessorGraph<GraphSizeType> graph;
+    graph.num_vertices = num_vertices;
+    graph.num_edges = num_edges_;
+    graph.next_edge_bits = next_edge_bits_.data();
+    graph.explicit_edge_bits = explicit_edge_bits_.data();
+    graph.explicit_edge_ranks = explicit_edge_ranks_.data();
+    graph.explicit_offsets = explicit_offsets_.data();
+    graph.explicit_neighbors = explicit_neighbors_.data();
+    graph.labels = labels;
+    return graph;
+  }
+
+ protected:
+  GraphSizeType num_edges_ = 0;
+  std::vector<uint64_t> next_edge_bits_;
+  std::vector<uint64_t> explicit_edge_bits_;
+  std::vector<GraphSizeType> explicit_edge_ranks_;
+  std::vector<GraphSizeType> explicit_offsets_;
+  std::vector<GraphSizeType> explicit_neighbors_;
+};
+
+}  // namespace sga
+
+#endif  // SGA_IMPLICITSUCCESSORGRAPH_H_
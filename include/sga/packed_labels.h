@@ -0,0 +1,301 @@
+#ifndef SGA_PACKEDLABELS_H_
+#define SGA_PACKEDLABELS_H_
+
+#include <assert.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cpu_dispatch.h"
+
+#if defined(__SSE2__) || SGA_HAS_CPU_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace sga {
+
+// Set row[i] to value, plus cost if bit i of mismatch_mask is set, for i in
+// [0, length), where length is at most 64.
+template <class RowValueType>
+inline void ExpandMismatchMask(const uint64_t mismatch_mask,
+                               const RowValueType value,
+                               const RowValueType cost, const size_t length,
+                               RowValueType *row) {
+  for (size_t i = 0; i < length; ++i) {
+    row[i] = value + (((mismatch_mask >> i) & 1) ? cost : 0);
+  }
+}
+
+// Expand the 64 bits of a mismatch mask as above. SSE2 is part of the x86-64
+// baseline, so these are used without dispatch, and the AVX2 ones below are
+// picked at runtime, see PackedLabels::SetInstructionSet. The other row value
+// types are expanded with the loop above.
+template <class RowValueType>
+inline void ExpandMismatchMaskWithSse2(const uint64_t mismatch_mask,
+                                       const RowValueType value,
+                                       const RowValueType cost,
+                                       RowValueType *row) {
+  ExpandMismatchMask(mismatch_mask, value, cost, 64, row);
+}
+
+#if defined(__SSE2__)
+inline void ExpandMismatchMaskWithSse2(const uint64_t mismatch_mask,
+                                       const int16_t value, const int16_t cost,
+                                       int16_t *row) {
+  // Each lane tests its own bit of the 8 mask bits broadcast to all lanes.
+  const __m128i bits = _mm_setr_epi16(1 << 0, 1 << 1, 1 << 2, 1 << 3, 1 << 4,
+                                      1 << 5, 1 << 6, 1 << 7);
+  const __m128i values = _mm_set1_epi16(value);
+  const __m128i costs = _mm_set1_epi16(cost);
+  for (size_t i = 0; i < 64; i += 8) {
+    const __m128i mask = _mm_set1_epi16((int16_t)(mismatch_mask >> i));
+    const __m128i is_mismatch =
+        _mm_cmpeq_epi16(_mm_and_si128(mask, bits), bits);
+    _mm_storeu_si128((__m128i *)(row + i),
+                     _mm_add_epi16(values, _mm_and_si128(is_mismatch, costs)));
+  }
+}
+
+inline void ExpandMismatchMaskWithSse2(const uint64_t mismatch_mask,
+                                       const int32_t value, const int32_t cost,
+                                       int32_t *row) {
+  const __m128i bits = _mm_setr_epi32(1 << 0, 1 << 1, 1 << 2, 1 << 3);
+  const __m128i values = _mm_set1_epi32(value);
+  const __m128i costs = _mm_set1_epi32(cost);
+  for (size_t i = 0; i < 64; i += 4) {
+    const __m128i mask = _mm_set1_epi32((int32_t)(mismatch_mask >> i));
+    const __m128i is_mismatch =
+        _mm_cmpeq_epi32(_mm_and_si128(mask, bits), bits);
+    _mm_storeu_si128((__m128i *)(row + i),
+                     _mm_add_epi32(values, _mm_and_si128(is_mismatch, costs)));
+  }
+}
+#endif
+
+#if SGA_HAS_CPU_DISPATCH
+template <class RowValueType>
+SGA_TARGET_AVX2 inline void ExpandMismatchMaskWithAvx2(
+    const uint64_t mismatch_mask, const RowValueType value,
+    const RowValueType cost, RowValueType *row) {
+  ExpandMismatchMask(mismatch_mask, value, cost, 64, row);
+}
+
+SGA_TARGET_AVX2 inline void ExpandMismatchMaskWithAvx2(
+    const uint64_t mismatch_mask, const int16_t value, const int16_t cost,
+    int16_t *row) {
+  const __m256i bits = _mm256_setr_epi16(
+      1 << 0, 1 << 1, 1 << 2, 1 << 3, 1 << 4, 1 << 5, 1 << 6, 1 << 7, 1 << 8,
+      1 << 9, 1 << 10, 1 << 11, 1 << 12, 1 << 13, 1 << 14, (int16_t)(1 << 15));
+  const __m256i values = _mm256_set1_epi16(value);
+  const __m256i costs = _mm256_set1_epi16(cost);
+  for (size_t i = 0; i < 64; i += 16) {
+    const __m256i mask = _mm256_set1_epi16((int16_t)(mismatch_mask >> i));
+    const __m256i is_mismatch =
+        _mm256_cmpeq_epi16(_mm256_and_si256(mask, bits), bits);
+    _mm256_storeu_si256(
+        (__m256i *)(row + i),
+        _mm256_add_epi16(values, _mm256_and_si256(is_mismatch, costs)));
+  }
+}
+
+SGA_TARGET_AVX2 inline void ExpandMismatchMaskWithAvx2(
+    const uint64_t mismatch_mask, const int32_t value, const int32_t cost,
+    int32_t *row) {
+  const __m256i bits = _mm256_setr_epi32(1 << 0, 1 << 1, 1 << 2, 1 << 3,
+                                         1 << 4, 1 << 5, 1 << 6, 1 << 7);
+  const __m256i values = _mm256_set1_epi32(value);
+  const __m256i costs = _mm256_set1_epi32(cost);
+  for (size_t i = 0; i < 64; i += 8) {
+    const __m256i mask = _mm256_set1_epi32((int32_t)(mismatch_mask >> i));
+    const __m256i is_mismatch =
+        _mm256_cmpeq_epi32(_mm256_and_si256(mask, bits), bits);
+    _mm256_storeu_si256(
+        (__m256i *)(row + i),
+        _mm256_add_epi32(values, _mm256_and_si256(is_mismatch, costs)));
+  }
+}
+#endif
+
+// Vertex labels packed in 2 bits each, 32 per word. Only A, C, G and T can be
+// packed. Any other label (N, IUPAC codes, lower case) is an exception, which
+// is flagged in a bit mask and compared with its char, so that comparing a
+// base with the packed labels gives the same result as comparing the chars.
+// The packed words and the mask are either built or viewed in an index.
+class PackedLabels {
+ public:
+  PackedLabels() : num_labels_(0) {}
+  PackedLabels(const PackedLabels &) = delete;
+  PackedLabels &operator=(const PackedLabels &) = delete;
+  ~PackedLabels() {}
+
+  size_t GetNumLabels() const { return num_labels_; }
+
+  // The number of words of a mismatch mask, one bit per label.
+  size_t GetNumMaskWords() const { return (num_labels_ + 63) / 64; }
+
+  size_t GetNumPackedWords() const { return (num_labels_ + 31) / 32; }
+
+  const uint64_t *GetPackedWords() const { return packed_words_view_; }
+
+  const uint64_t *GetExceptionMask() const { return exception_mask_view_; }
+
+  // The rows are expanded with AVX2 by default when the CPU supports it. A
+  // wider instruction set than supported is lowered to the supported one.
+  void SetInstructionSet(const InstructionSet instruction_set) {
+    instruction_set_ = std::min(instruction_set, GetSupportedInstructionSet());
+  }
+
+  void Build(const char *labels, const size_t num_labels) {
+    num_labels_ = num_labels;
+    packed_words_.assign(GetNumPackedWords(), 0);
+    exception_mask_.assign(GetNumMaskWords(), 0);
+    for (size_t i = 0; i < num_labels_; ++i) {
+      const int code = GetCode(labels[i]);
+      if (code < 0) {
+        exception_mask_[i >> 6] |= (uint64_t)1 << (i & 63);
+      } else {
+        packed_words_[i >> 5] |= (uint64_t)code << ((i & 31) << 1);
+      }
+    }
+    SetView(labels, num_labels, packed_words_.data(), exception_mask_.data());
+  }
+
+  // View the GetNumPackedWords() packed words and the GetNumMaskWords() words
+  // of the exception mask built for the labels, e.g. in an index.
+  void SetView(const char *labels, const size_t num_labels,
+               const uint64_t *packed_words, const uint64_t *exception_mask) {
+    labels_ = labels;
+    num_labels_ = num_labels;
+    packed_words_view_ = packed_words;
+    exception_mask_view_ = exception_mask;
+  }
+
+  static bool IsMismatch(const uint64_t *mismatch_mask, const size_t i) {
+    return (mismatch_mask[i >> 6] >> (i & 63)) & 1;
+  }
+
+  // Word wi of the mismatch mask of base, where bit i is set if base is not
+  // label 64 * wi + i. The bits past the last label are set to 0.
+  uint64_t GetMismatchWord(const char base, const size_t wi) const {
+    return ComputeMismatchWord(base, GetCode(base), wi);
+  }
+
+  // In one sweep over the packed labels, set bit i of mismatch_mask if base is
+  // not label i and set row[i] to value plus cost if it is a mismatch. The
+  // mask must have GetNumMaskWords() words and the row GetNumLabels() values.
+  template <class RowValueType>
+  void InitializeRow(const char base, const RowValueType value,
+                     const RowValueType cost, uint64_t *mismatch_mask,
+                     RowValueType *row) const {
+    const int code = GetCode(base);
+    const size_t num_mask_words = GetNumMaskWords();
+    for (size_t wi = 0; wi < num_mask_words; ++wi) {
+      mismatch_mask[wi] = ComputeMismatchWord(base, code, wi);
+    }
+
+#if SGA_HAS_CPU_DISPATCH
+    if (instruction_set_ >= InstructionSet::kAvx2) {
+      ExpandMismatchMasksWithAvx2(mismatch_mask, value, cost, row);
+      return;
+    }
+#endif
+    const size_t num_full_words = num_labels_ >> 6;
+    for (size_t wi = 0; wi < num_full_words; ++wi) {
+      ExpandMismatchMaskWithSse2(mismatch_mask[wi], value, cost,
+                                 row + (wi << 6));
+    }
+    if ((num_labels_ & 63) != 0) {
+      ExpandMismatchMask(mismatch_mask[num_full_words], value, cost,
+                         num_labels_ & 63, row + (num_full_words << 6));
+    }
+  }
+
+ protected:
+  // Word wi of the mismatch mask of base, whose code is given.
+  uint64_t ComputeMismatchWord(const char base, const int code,
+                               const size_t wi) const {
+    const size_t num_last_bits = num_labels_ - (wi << 6);
+    const uint64_t label_bits = num_last_bits >= 64
+                                    ? ~(uint64_t)0
+                                    : ((uint64_t)1 << num_last_bits) - 1;
+    if (code < 0) {
+      // An exceptional base only matches the exceptions with the same char.
+      uint64_t mismatch_bits = ~(uint64_t)0;
+      for (uint64_t exceptions = exception_mask_view_[wi]; exceptions != 0;
+           exceptions &= exceptions - 1) {
+        const size_t bit = __builtin_ctzll(exceptions);
+        if (labels_[(wi << 6) + bit] == base) {
+          mismatch_bits &= ~((uint64_t)1 << bit);
+        }
+      }
+      return mismatch_bits & label_bits;
+    }
+    const uint64_t pattern = (uint64_t)code * 0x5555555555555555ULL;
+    const size_t pi = wi << 1;
+    uint64_t mismatch_bits = GetMismatchBits(packed_words_view_[pi] ^ pattern);
+    if (pi + 1 < GetNumPackedWords()) {
+      mismatch_bits |= GetMismatchBits(packed_words_view_[pi + 1] ^ pattern)
+                       << 32;
+    }
+    // The exceptions never match the bases that can be packed.
+    return (mismatch_bits | exception_mask_view_[wi]) & label_bits;
+  }
+
+#if SGA_HAS_CPU_DISPATCH
+  template <class RowValueType>
+  SGA_TARGET_AVX2 void ExpandMismatchMasksWithAvx2(
+      const uint64_t *mismatch_mask, const RowValueType value,
+      const RowValueType cost, RowValueType *row) const {
+    const size_t num_full_words = num_labels_ >> 6;
+    for (size_t wi = 0; wi < num_full_words; ++wi) {
+      ExpandMismatchMaskWithAvx2(mismatch_mask[wi], value, cost,
+                                 row + (wi << 6));
+    }
+    if ((num_labels_ & 63) != 0) {
+      ExpandMismatchMask(mismatch_mask[num_full_words], value, cost,
+                         num_labels_ & 63, row + (num_full_words << 6));
+    }
+  }
+#endif
+
+  static int GetCode(const char base) {
+    switch (base) {
+      case 'A':
+        return 0;
+      case 'C':
+        return 1;
+      case 'G':
+        return 2;
+      case 'T':
+        return 3;
+      default:
+        return -1;
+    }
+  }
+
+  // Given 32 2-bit slots XORed with a base, return a 32-bit mask with bit i set
+  // if slot i is not zero, i.e. label i is not the base.
+  static uint64_t GetMismatchBits(uint64_t x) {
+    x = (x | (x >> 1)) & 0x5555555555555555ULL;
+    x = (x | (x >> 1)) & 0x3333333333333333ULL;
+    x = (x | (x >> 2)) & 0x0f0f0f0f0f0f0f0fULL;
+    x = (x | (x >> 4)) & 0x00ff00ff00ff00ffULL;
+    x = (x | (x >> 8)) & 0x0000ffff0000ffffULL;
+    x = (x | (x >> 16)) & 0x00000000ffffffffULL;
+    return x;
+  }
+
+  size_t num_labels_;
+  const char *labels_ = nullptr;
+  const uint64_t *packed_words_view_ = nullptr;
+  const uint64_t *exception_mask_view_ = nullptr;
+  std::vector<uint64_t> packed_words_;
+  std::vector<uint64_t> exception_mask_;
+  InstructionSet instruction_set_ = GetSupportedInstructionSet();
+};
+
+}  // namespace sga
+
+#endif  // SGA_PACKEDLABELS_H_
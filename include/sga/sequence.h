@@ -10,49 +10,69 @@
 
 
 namespace sga {
+// A read-only view of a null-terminated string owned by someone else, like
+// std::string_view but with c_str() since the viewed strings are always
+// terminated.
+class StringView {
+ public:
+  StringView() : data_(""), length_(0) {}
+  StringView(const char *data, const uint32_t length)
+      : data_(data), length_(length) {}
+
+  const char *data() const { return data_; }
+  const char *c_str() const { return data_; }
+  uint32_t size() const { return length_; }
+  uint32_t length() const { return length_; }
+  bool empty() const { return length_ == 0; }
+  const char *begin() const { return data_; }
+  const char *end() const { return data_ + length_; }
+  char operator[](const uint32_t i) const { return data_[i]; }
+
+  std::string ToString() const { return std::string(data_, length_); }
+
+ protected:
+  const char *data_;
+  uint32_t length_;
+};
+
+// A sequence record. It does not own its name, bases and quality scores but
+// only views them, so it is cheap to copy. The viewed strings must outlive the
+// sequence, e.g. the ones of a SequenceBatch are valid until the next batch is
+// loaded.
 class Sequence {
  public:
   Sequence() {}
   Sequence(const uint32_t length, const char *name, const char *sequence) {
-    Sequence();
-    name_ = name;
-    sequence_ = sequence;
+    Update(length, name, sequence);
   }
   Sequence(const uint32_t length, const char *name, const char *sequence,
            const char *quality_scores) {
-    Sequence(length, name, sequence);
-    quality_scores_ = quality_scores;
-  }
-  ~Sequence() {
-    name_.clear();
-    sequence_.clear();
-    quality_scores_.clear();
+    Update(length, name, sequence, quality_scores);
   }
+  ~Sequence() {}
 
-  std::string const &GetName() const { return name_; }
-  std::string const &GetSequence() const { return sequence_; }
+  StringView GetName() const { return name_; }
+  StringView GetSequence() const { return sequence_; }
   uint32_t GetLength() const { return sequence_.length(); }
-  std::string const &GetQualityScores() const { return quality_scores_; }
+  StringView GetQualityScores() const { return quality_scores_; }
 
   inline void Update(const uint32_t length, const char *name,
                      const char *sequence) {  // for fasta
-    name_.clear();
-    name_ = name;
-    sequence_.clear();
-    sequence_ = sequence;
+    name_ = StringView(name, strlen(name));
+    sequence_ = StringView(sequence, length);
+    quality_scores_ = StringView();
   }
   inline void Update(const uint32_t length, const char *name,
                      const char *sequence,
                      const char *quality_scores) {  // for fastq
     Update(length, name, sequence);
-    quality_scores_.clear();
-    quality_scores_ = quality_scores;
+    quality_scores_ = StringView(quality_scores, length);
   }
 
  protected:
-  std::string name_;
-  std::string sequence_;
-  std::string quality_scores_;
+  StringView name_;
+  StringView sequence_;
+  StringView quality_scores_;
 };
 
 }  // namespace sga
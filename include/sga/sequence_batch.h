@@ -4,13 +4,15 @@
 #include <assert.h>
 
 #include <string>
+#include <thread>
 #include <vector>
 #include <cstdint>
 #include "kseq.h"
 #include "sequence.h"
+#include "sequence_input_stream.h"
 #include "utils.h"
 
-KSEQ_INIT(int, read)
+KSEQ_INIT(sga::SequenceInputStream *, sga::ReadSequenceInputStream)
 
 namespace sga {
 
@@ -19,88 +21,192 @@ class SequenceBatch {
   SequenceBatch(const uint32_t max_batch_size) {
     max_batch_size_ = max_batch_size;
     num_loaded_sequences_ = 0;
-    sequence_batch_.reserve(max_batch_size_);
-    // Construct once and use update methods when loading each batch
-    sequence_batch_.assign(max_batch_size_, sga::Sequence(0, "", ""));
-    sequence_file_ = nullptr;
     sequence_kseq_ = nullptr;
+    load_asynchronously_ = false;
+    num_prefetched_sequences_ = 0;
+    prefetch_wait_time_ = 0;
   }
 
-  // Only string and vector, thus nothing to free
-  ~SequenceBatch() {}
+  // Make sure the loading thread is not left running.
+  ~SequenceBatch() { FinalizeLoading(); }
 
   uint32_t GetMaxBatchSize() const { return max_batch_size_; }
 
   uint32_t GetNumLoadedSequences() const { return num_loaded_sequences_; }
 
-  std::vector<sga::Sequence> const &GetSequenceBatch() const {
-    return sequence_batch_;
-  }
+  // The real time LoadBatch has spent waiting for the prefetched batches since
+  // the loading was initialized, in seconds.
+  double GetPrefetchWaitTime() const { return prefetch_wait_time_; }
 
-  sga::Sequence const &GetSequence(uint32_t sequence_index) const {
-    return sequence_batch_.at(sequence_index);
+  // The returned sequence views the batch and is valid until the next batch
+  // is loaded.
+  sga::Sequence GetSequence(uint32_t sequence_index) const {
+    return sequence_batch_.GetSequence(sequence_index);
   }
 
-  void InitializeLoading(const std::string &sequence_file_path) {
+  // The sequence file can be plain text, gzip or BGZF. BGZF blocks are
+  // decompressed with num_decompression_threads threads. When
+  // load_asynchronously is true, a background thread loads the next batch into
+  // a second buffer while the current one is being used, and LoadBatch only
+  // waits for it and swaps the two buffers. The loading of a previous file is
+  // finalized first. Return false if the file cannot be opened.
+  bool InitializeLoading(const std::string &sequence_file_path,
+                         const bool load_asynchronously = false,
+                         const int num_decompression_threads = 1) {
+    FinalizeLoading();
     sequence_file_path_ = sequence_file_path;
-    sequence_file_ = fopen(sequence_file_path_.c_str(), "r");
-    assert(sequence_file_ != NULL);
-    sequence_kseq_ = kseq_init(fileno(sequence_file_));
+    prefetch_wait_time_ = 0;
+    if (!sequence_input_stream_.Open(sequence_file_path_,
+                                     num_decompression_threads)) {
+      return false;
+    }
+    sequence_kseq_ = kseq_init(&sequence_input_stream_);
+    load_asynchronously_ = load_asynchronously;
+    if (load_asynchronously_) {
+      StartPrefetching();
+    }
+    return true;
   }
 
   // Return the number of sequences loaded into the batch
-  // and return 0 if there is no more sequences
+  // and return 0 if there is no more sequences or the file is corrupt
   uint32_t LoadBatch() {
+    if (!load_asynchronously_) {
+      num_loaded_sequences_ = LoadSequences(sequence_batch_);
+      return num_loaded_sequences_;
+    }
+
     double real_start_time = sga::GetRealTime();
-    num_loaded_sequences_ = 0;
-    for (uint32_t sequence_index = 0; sequence_index < max_batch_size_;
-         ++sequence_index) {
-      int length = kseq_read(sequence_kseq_);
-      // Skip the sequences of length 0
-      if (length == 0)
-        continue;
-      else if (length > 0) {
-        if (sequence_kseq_->qual.l == 0) {  // fasta file
-          sequence_batch_[sequence_index].Update(length, sequence_kseq_->name.s,
-                                                 sequence_kseq_->seq.s);
-        } else {  // fastq file
-          sequence_batch_[sequence_index].Update(length, sequence_kseq_->name.s,
-                                                 sequence_kseq_->seq.s,
-                                                 sequence_kseq_->qual.s);
-        }
-        ++num_loaded_sequences_;
-      } else {
-        assert(length == -1);  // make sure to reach the end of file rather than
-                               // meet an error
-        break;
-      }
+    if (loading_thread_.joinable()) {
+      loading_thread_.join();
+    }
+    sequence_batch_.Swap(prefetched_sequence_batch_);
+    num_loaded_sequences_ = num_prefetched_sequences_;
+    num_prefetched_sequences_ = 0;
+    prefetch_wait_time_ += sga::GetRealTime() - real_start_time;
+    if (num_loaded_sequences_ > 0) {
+      StartPrefetching();
     }
-    std::cerr << "Number of sequences: " << num_loaded_sequences_ << "."
-              << std::endl;
-    std::cerr << "Loaded sequence batch successfully in "
-              << sga::GetRealTime() - real_start_time << "s." << std::endl;
     return num_loaded_sequences_;
   }
 
   void FinalizeLoading() {
-    if (sequence_file_ != nullptr) {
-      fclose(sequence_file_);
-      sequence_file_ = nullptr;
+    if (loading_thread_.joinable()) {
+      loading_thread_.join();
     }
 
     if (sequence_kseq_ != nullptr) {
       kseq_destroy(sequence_kseq_);
       sequence_kseq_ = nullptr;
     }
+
+    sequence_input_stream_.Close();
   }
 
  protected:
+  // The records of a batch stored back to back in one byte array as
+  // "name\0bases\0quality_scores\0", so that loading a batch only appends to
+  // the array and barely allocates once the array is large enough.
+  class SequenceArena {
+   public:
+    void Clear() {
+      bytes_.clear();
+      records_.clear();
+    }
+
+    void Swap(SequenceArena &other) {
+      bytes_.swap(other.bytes_);
+      records_.swap(other.records_);
+    }
+
+    // The quality scores are empty for fasta records.
+    void AddSequence(const kstring_t &name, const kstring_t &bases,
+                     const kstring_t &quality_scores) {
+      records_.push_back(
+          {bytes_.size(), (uint32_t)name.l, (uint32_t)bases.l,
+           (uint32_t)quality_scores.l});
+      Append(name);
+      Append(bases);
+      Append(quality_scores);
+    }
+
+    sga::Sequence GetSequence(const uint32_t sequence_index) const {
+      const Record &record = records_.at(sequence_index);
+      const char *name = bytes_.data() + record.offset;
+      const char *bases = name + record.name_length + 1;
+      if (record.quality_scores_length == 0) {
+        return sga::Sequence(record.length, name, bases);
+      }
+      return sga::Sequence(record.length, name, bases,
+                           bases + record.length + 1);
+    }
+
+   protected:
+    struct Record {
+      size_t offset;
+      uint32_t name_length;
+      uint32_t length;
+      uint32_t quality_scores_length;
+    };
+
+    void Append(const kstring_t &string) {
+      bytes_.insert(bytes_.end(), string.s, string.s + string.l);
+      bytes_.push_back('\0');
+    }
+
+    std::vector<char> bytes_;
+    std::vector<Record> records_;
+  };
+
+  void StartPrefetching() {
+    loading_thread_ = std::thread([this]() {
+      num_prefetched_sequences_ = LoadSequences(prefetched_sequence_batch_);
+    });
+  }
+
+  // Load at most max_batch_size_ sequences into the given buffer and return
+  // the number of sequences loaded.
+  uint32_t LoadSequences(SequenceArena &sequence_batch) {
+    sequence_batch.Clear();
+    if (sequence_kseq_ == nullptr) {
+      return 0;
+    }
+    uint32_t num_loaded_sequences = 0;
+    while (num_loaded_sequences < max_batch_size_) {
+      int length = kseq_read(sequence_kseq_);
+      // Skip the sequences of length 0
+      if (length == 0)
+        continue;
+      else if (length > 0) {
+        sequence_batch.AddSequence(sequence_kseq_->name, sequence_kseq_->seq,
+                                   sequence_kseq_->qual);
+        ++num_loaded_sequences;
+      } else if (length == -1) {
+        break;
+      } else {
+        // A truncated record or a corrupt file ends the loading, without the
+        // sequences of the batch which may be corrupt too.
+        std::cerr << "Failed to read " << sequence_file_path_
+                  << ", stop loading sequences." << std::endl;
+        sequence_batch.Clear();
+        return 0;
+      }
+    }
+    return num_loaded_sequences;
+  }
+
   uint32_t max_batch_size_;
   uint32_t num_loaded_sequences_;
-  std::vector<sga::Sequence> sequence_batch_;
+  SequenceArena sequence_batch_;
   std::string sequence_file_path_;
-  FILE *sequence_file_;
+  SequenceInputStream sequence_input_stream_;
   kseq_t *sequence_kseq_;
+  // For asynchronous loading
+  bool load_asynchronously_;
+  std::thread loading_thread_;
+  SequenceArena prefetched_sequence_batch_;
+  uint32_t num_prefetched_sequences_;
+  double prefetch_wait_time_;
 };
 
 }  // namespace sga
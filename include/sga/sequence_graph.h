@@ -1,17 +1,27 @@
 #ifndef SGA_SEQUENCEGRAPH_H
 #define SGA_SEQUENCEGRAPH_H
 
+#include <assert.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iterator>
+#include <limits>
 #include <queue>
 #include <sstream>
 #include <string>
-#include <unordered_map>
 #include <vector>
 #include <cstdint>
+#include "alignment_workspace.h"
 #include "gfa.h"
+#include "implicit_successor_graph.h"
 //#include "khash.h"
+#include "packed_labels.h"
 #include "sequence.h"
 #include "utils.h"
 
@@ -19,33 +29,92 @@ namespace sga {
 
 // KHASH_MAP_INIT_INT(k32, uint32_t);
 
-template <class GraphSizeType = int32_t, class QueryLengthType = int16_t,
-          class ScoreType = int16_t>
-struct VertexWithDistanceForDijkstra {
-  GraphSizeType graph_vertex_id;
-  QueryLengthType query_index;
-  ScoreType distance;
-  bool is_reverse_complementary;
-};
-
 template <class GraphSizeType = int32_t>
 struct DijkstraAlgorithmStatistics {
   GraphSizeType forward_num_cells = 0;
   GraphSizeType rc_num_cells = 0;
 };
 
+// An immutable view of the char labeled graph in compressed sparse row (CSR)
+// format. The out-neighbors of vertex v are stored in neighbors[offsets[v]]
+// to neighbors[offsets[v + 1] - 1] and its label is labels[v]. The view does
+// not own the arrays.
+template <class GraphSizeType = int32_t>
+struct CompressedSparseRowGraph {
+  GraphSizeType num_vertices = 0;
+  const GraphSizeType *offsets = nullptr;
+  const GraphSizeType *neighbors = nullptr;
+  const char *labels = nullptr;
+
+  struct NeighborRange {
+    const GraphSizeType *first;
+    const GraphSizeType *last;
+    const GraphSizeType *begin() const { return first; }
+    const GraphSizeType *end() const { return last; }
+  };
+
+  GraphSizeType GetNumEdges() const {
+    return num_vertices == 0 ? 0 : offsets[num_vertices];
+  }
+
+  NeighborRange GetNeighbors(GraphSizeType vertex) const {
+    return {neighbors + offsets[vertex], neighbors + offsets[vertex + 1]};
+  }
+};
+
+// The header of the binary graph index written by SequenceGraph::SaveIndex.
+// It is followed by the arrays of the implicit successor char labeled graph,
+// the CSR compacted graph, the chain offsets, the labels, the vertex id
+// mappings, the cyclic components and the packed labels, each padded to a
+// multiple of 8 bytes.
+struct SequenceGraphIndexHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t graph_size_type_size;
+  uint64_t num_vertices;
+  uint64_t num_edges;
+  uint64_t num_explicit_vertices;
+  uint64_t num_explicit_edges;
+  uint64_t num_compacted_vertices;
+  uint64_t num_compacted_edges;
+  // 0 unless the graph is bidirected.
+  uint64_t num_forward_vertices;
+  uint64_t num_cyclic_components;
+};
+
+// The orders in which the vertices can be renumbered, see
+// SequenceGraph::RenumberVertices. Both are topological orders of the strongly
+// connected components. Breadth first visits the branches of a bubble in
+// lockstep, while depth first lays out each unitig contiguously and puts a
+// vertex right before its successor on the chain.
+enum class VertexOrder { kBreadthFirst, kDepthFirst };
+
 template <class GraphSizeType = int32_t, class QueryLengthType = int16_t,
           class ScoreType = int16_t>
 class SequenceGraph {
  public:
+  typedef AlignmentWorkspace<GraphSizeType, QueryLengthType, ScoreType>
+      Workspace;
+
   SequenceGraph() {}
-  ~SequenceGraph() {}
+  ~SequenceGraph() { UnmapIndex(); }
+  // The graph views point into the vectors or the index mapping of the graph,
+  // so a copy would point into the ones of its source.
+  SequenceGraph(const SequenceGraph &) = delete;
+  SequenceGraph &operator=(const SequenceGraph &) = delete;
 
   GraphSizeType GetNumVerticesInCompactedGraph() {
+    if (IsCompressedRepresentationGenerated()) {
+      return compacted_graph_.num_vertices;
+    }
     return compacted_graph_labels_.size();
   }
 
   GraphSizeType GetNumEdgesInCompactedGraph() {
+    if (IsCompressedRepresentationGenerated()) {
+      return compacted_graph_.GetNumEdges();
+    }
+
     GraphSizeType num_edges = 0;
     for (std::vector<GraphSizeType> &neighbors :
          compacted_graph_adjacency_list_) {
@@ -54,9 +123,18 @@ class SequenceGraph {
     return num_edges;
   }
 
-  GraphSizeType GetNumVertices() { return labels_.size(); }
+  GraphSizeType GetNumVertices() const {
+    if (IsCompressedRepresentationGenerated()) {
+      return graph_.num_vertices;
+    }
+    return labels_.size();
+  }
 
   GraphSizeType GetNumEdges() {
+    if (IsCompressedRepresentationGenerated()) {
+      return graph_.GetNumEdges();
+    }
+
     GraphSizeType num_edges = 0;
     for (std::vector<GraphSizeType> &neighbors : adjacency_list_) {
       num_edges += neighbors.size();
@@ -64,6 +142,10 @@ class SequenceGraph {
     return num_edges;
   }
 
+  bool IsCompressedRepresentationGenerated() const {
+    return graph_.labels != nullptr;
+  }
+
   void PrintLayer(const std::vector<ScoreType> &layer,
                   const std::vector<GraphSizeType> &order) {
     for (GraphSizeType i = 0; i < GetNumVertices(); ++i) {
@@ -72,21 +154,556 @@ class SequenceGraph {
     std::cerr << std::endl;
   }
 
-  void GenerateCompressedRepresentation() {
+  // Convert the adjacency list of the char labeled graph into the implicit
+  // successor graph used by all the alignment kernels, after renumbering the
+  // vertices. The adjacency list is freed afterwards, so this should be called
+  // once after GenerateCharLabeledGraph and before any alignment.
+  void GenerateCompressedRepresentation(
+      const VertexOrder vertex_order = VertexOrder::kDepthFirst) {
     GraphSizeType num_vertices = GetNumVertices();
     GraphSizeType num_edges = GetNumEdges();
     std::cerr << "# vertices: " << num_vertices << ", # edges: " << num_edges
               << std::endl;
 
-    look_up_table_.reserve(GetNumVertices());
-    look_up_table_.push_back(0);
+    // The graph is first put in CSR format to be renumbered.
+    std::vector<GraphSizeType> look_up_table;
+    std::vector<GraphSizeType> neighbor_table;
+    look_up_table.reserve(num_vertices + 1);
+    neighbor_table.reserve(num_edges);
+    look_up_table.push_back(0);
     for (auto &neighbor_list : adjacency_list_) {
-      GraphSizeType last_sum = look_up_table_.back();
-      look_up_table_.push_back(neighbor_list.size());
-      look_up_table_.back() += last_sum;
-      neighbor_table_.insert(neighbor_table_.end(), neighbor_list.begin(),
-                             neighbor_list.end());
+      GraphSizeType last_sum = look_up_table.back();
+      look_up_table.push_back(neighbor_list.size());
+      look_up_table.back() += last_sum;
+      neighbor_table.insert(neighbor_table.end(), neighbor_list.begin(),
+                            neighbor_list.end());
+    }
+
+    std::vector<std::vector<GraphSizeType>>().swap(adjacency_list_);
+
+    // The compacted graph is kept in CSR format as well, together with where
+    // the chain of each compacted vertex is in the char labeled graph. The
+    // first char of compacted vertex v is vertex v and the rest of its chain
+    // are vertices chain_offsets[v] to chain_offsets[v + 1] - 1.
+    const GraphSizeType num_compacted_vertices =
+        compacted_graph_labels_.size();
+    compacted_look_up_table_.reserve(num_compacted_vertices + 1);
+    compacted_look_up_table_.push_back(0);
+    for (auto &neighbor_list : compacted_graph_adjacency_list_) {
+      compacted_look_up_table_.push_back(compacted_look_up_table_.back() +
+                                         neighbor_list.size());
+      compacted_neighbor_table_.insert(compacted_neighbor_table_.end(),
+                                       neighbor_list.begin(),
+                                       neighbor_list.end());
+    }
+    chain_offsets_.reserve(num_compacted_vertices + 1);
+    chain_offsets_.push_back(num_compacted_vertices);
+    for (const std::string &compacted_graph_label : compacted_graph_labels_) {
+      chain_offsets_.push_back(chain_offsets_.back() +
+                               compacted_graph_label.length() - 1);
+    }
+    assert(chain_offsets_.back() ==
+           (IsBidirected() ? num_forward_vertices_ : num_vertices));
+
+    compacted_graph_.num_vertices = num_compacted_vertices;
+    compacted_graph_.offsets = compacted_look_up_table_.data();
+    compacted_graph_.neighbors = compacted_neighbor_table_.data();
+    chain_offsets_view_ = chain_offsets_.data();
+
+    CompressedSparseRowGraph<GraphSizeType> graph;
+    graph.num_vertices = num_vertices;
+    graph.offsets = look_up_table.data();
+    graph.neighbors = neighbor_table.data();
+    graph.labels = labels_.data();
+    std::vector<GraphSizeType> order;
+    std::vector<GraphSizeType> component_ids;
+    CondenseStronglyConnectedComponents(graph, vertex_order, order,
+                                        component_ids);
+    RenumberVertices(order, look_up_table, neighbor_table, graph);
+    graph_arrays_.Build(graph);
+    graph_ = graph_arrays_.GetView(num_vertices, labels_.data());
+    for (GraphSizeType vertex = 0; vertex < num_vertices; ++vertex) {
+      order[vertex] = component_ids[original_vertex_ids_[vertex]];
+    }
+    FindCyclicComponents(/*component_ids=*/order);
+    packed_labels_.Build(graph_.labels, graph_.num_vertices);
+  }
+
+  bool IsAcyclic() const { return is_acyclic_; }
+
+  // Whether the graph holds both strands, see
+  // GenerateReverseComplementaryCharLabeledGraph.
+  bool IsBidirected() const { return num_forward_vertices_ != 0; }
+
+  // Whether a vertex of a bidirected graph is on the reverse complementary
+  // strand. Vertex 0 is on both strands and is reported as forward.
+  bool IsReverseComplementaryVertex(const GraphSizeType vertex) const {
+    return IsBidirected() &&
+           original_vertex_ids_view_[vertex] >= num_forward_vertices_;
+  }
+
+  // The vertices of graph_ are renumbered once the compressed representation
+  // is generated, see RenumberVertices. The compacted graph, the chain offsets
+  // and the start vertices given to the extension functions use the original
+  // ids of the char labeled graph, while the other functions taking or
+  // returning a vertex, e.g. GetVertexLabel, use the new ones.
+  GraphSizeType GetOriginalVertexId(const GraphSizeType vertex) const {
+    return original_vertex_ids_view_[vertex];
+  }
+
+  GraphSizeType GetVertexId(const GraphSizeType original_vertex) const {
+    return vertex_ids_view_[original_vertex];
+  }
+
+  // Renumber the vertices in the given order, which lists the strongly
+  // connected components one after another in topological order. Then every
+  // edge either stays in a component or goes from a smaller id to a larger
+  // one, so that each row of the DP can be computed in one sweep over the
+  // ids, see ComputeLayerOnCondensedGraph. The virtual source, vertex 0, has
+  // no in-edges and keeps id 0. The given CSR graph and its arrays are
+  // replaced by the renumbered ones.
+  void RenumberVertices(const std::vector<GraphSizeType> &order,
+                        std::vector<GraphSizeType> &look_up_table,
+                        std::vector<GraphSizeType> &neighbor_table,
+                        CompressedSparseRowGraph<GraphSizeType> &graph) {
+    const GraphSizeType num_vertices = graph.num_vertices;
+    assert(order[0] == 0);
+    original_vertex_ids_ = order;
+    vertex_ids_.resize(num_vertices);
+    for (GraphSizeType vertex = 0; vertex < num_vertices; ++vertex) {
+      vertex_ids_[original_vertex_ids_[vertex]] = vertex;
+    }
+    original_vertex_ids_view_ = original_vertex_ids_.data();
+    vertex_ids_view_ = vertex_ids_.data();
+
+    std::vector<GraphSizeType> new_look_up_table;
+    std::vector<GraphSizeType> new_neighbor_table;
+    std::vector<char> labels;
+    new_look_up_table.reserve(num_vertices + 1);
+    new_neighbor_table.reserve(graph.GetNumEdges());
+    labels.reserve(num_vertices);
+    new_look_up_table.push_back(0);
+    for (GraphSizeType vertex = 0; vertex < num_vertices; ++vertex) {
+      const GraphSizeType original_vertex = original_vertex_ids_[vertex];
+      for (const GraphSizeType neighbor : graph.GetNeighbors(original_vertex)) {
+        new_neighbor_table.push_back(vertex_ids_[neighbor]);
+      }
+      new_look_up_table.push_back(new_neighbor_table.size());
+      labels.push_back(graph.labels[original_vertex]);
+    }
+    look_up_table.swap(new_look_up_table);
+    neighbor_table.swap(new_neighbor_table);
+    labels_.swap(labels);
+
+    graph.offsets = look_up_table.data();
+    graph.neighbors = neighbor_table.data();
+    graph.labels = labels_.data();
+  }
+
+  // Find the strongly connected components with Tarjan's algorithm, run
+  // iteratively to not overflow the stack on long chains. component_ids gets
+  // the component of each vertex and order gets the vertices grouped by
+  // component, with the components in the given topological order.
+  template <class GraphType>
+  void CondenseStronglyConnectedComponents(
+      const GraphType &graph, const VertexOrder vertex_order,
+      std::vector<GraphSizeType> &order,
+      std::vector<GraphSizeType> &component_ids) {
+    typedef typename GraphType::NeighborRange NeighborRange;
+    const GraphSizeType num_vertices = graph.num_vertices;
+    // num_vertices marks the vertices not discovered yet.
+    std::vector<GraphSizeType> discovery_indices(num_vertices, num_vertices);
+    std::vector<GraphSizeType> low_links(num_vertices, 0);
+    std::vector<bool> is_on_stack(num_vertices, false);
+    std::vector<GraphSizeType> stack;
+    // The vertices being explored and their out-neighbors left to explore.
+    std::vector<std::pair<GraphSizeType, NeighborRange>> call_stack;
+    component_ids.assign(num_vertices, 0);
+    // The vertices of each component, one component after another.
+    std::vector<GraphSizeType> component_members;
+    std::vector<GraphSizeType> component_offsets(1, 0);
+    component_members.reserve(num_vertices);
+    GraphSizeType num_discovered_vertices = 0;
+    GraphSizeType num_components = 0;
+    is_acyclic_ = true;
+
+    auto discover = [&](const GraphSizeType vertex) {
+      discovery_indices[vertex] = num_discovered_vertices;
+      low_links[vertex] = num_discovered_vertices;
+      ++num_discovered_vertices;
+      stack.push_back(vertex);
+      is_on_stack[vertex] = true;
+      call_stack.emplace_back(vertex, graph.GetNeighbors(vertex));
+    };
+
+    for (GraphSizeType root = 0; root < num_vertices; ++root) {
+      if (discovery_indices[root] != num_vertices) {
+        continue;
+      }
+      discover(root);
+      while (!call_stack.empty()) {
+        const GraphSizeType vertex = call_stack.back().first;
+        NeighborRange &neighbors = call_stack.back().second;
+        if (neighbors.first != neighbors.last) {
+          const GraphSizeType neighbor = *neighbors.first;
+          ++neighbors.first;
+          if (discovery_indices[neighbor] == num_vertices) {
+            discover(neighbor);
+          } else if (is_on_stack[neighbor]) {
+            low_links[vertex] =
+                std::min(low_links[vertex], discovery_indices[neighbor]);
+          }
+          continue;
+        }
+
+        call_stack.pop_back();
+        if (!call_stack.empty()) {
+          GraphSizeType &parent_low_link = low_links[call_stack.back().first];
+          parent_low_link = std::min(parent_low_link, low_links[vertex]);
+        }
+        if (low_links[vertex] == discovery_indices[vertex]) {
+          GraphSizeType member = 0;
+          do {
+            member = stack.back();
+            stack.pop_back();
+            is_on_stack[member] = false;
+            component_ids[member] = num_components;
+            component_members.push_back(member);
+          } while (member != vertex);
+          component_offsets.push_back(component_members.size());
+          if (component_offsets[num_components + 1] -
+                      component_offsets[num_components] >
+                  1 ||
+              HasSelfLoop(graph, vertex)) {
+            is_acyclic_ = false;
+          }
+          ++num_components;
+        }
+      }
+    }
+
+    // The components are found in reverse topological order, but they are
+    // sorted with Kahn's algorithm over the condensed graph instead, with the
+    // components ready to be sorted in a queue for the breadth first order or
+    // in a stack for the depth first one. Vertex 0 has no in-edges, so it goes
+    // first.
+    std::vector<GraphSizeType> in_degrees(num_components, 0);
+    for (GraphSizeType vertex = 0; vertex < num_vertices; ++vertex) {
+      for (const GraphSizeType neighbor : graph.GetNeighbors(vertex)) {
+        if (component_ids[neighbor] != component_ids[vertex]) {
+          ++in_degrees[component_ids[neighbor]];
+        }
+      }
+    }
+    std::vector<GraphSizeType> ready_components;
+    std::vector<bool> is_ready(num_components, false);
+    for (GraphSizeType vertex = 0; vertex < num_vertices; ++vertex) {
+      const GraphSizeType component = component_ids[vertex];
+      if (in_degrees[component] == 0 && !is_ready[component]) {
+        is_ready[component] = true;
+        ready_components.push_back(component);
+      }
+    }
+    const bool is_depth_first = vertex_order == VertexOrder::kDepthFirst;
+    if (is_depth_first) {
+      std::reverse(ready_components.begin(), ready_components.end());
+    }
+
+    order.clear();
+    order.reserve(num_vertices);
+    std::vector<GraphSizeType> neighbors;
+    size_t ready_components_head = 0;
+    while (ready_components_head < ready_components.size()) {
+      GraphSizeType component = 0;
+      if (is_depth_first) {
+        component = ready_components.back();
+        ready_components.pop_back();
+      } else {
+        component = ready_components[ready_components_head];
+        ++ready_components_head;
+      }
+      // The members of a component are popped from the stack in reverse order
+      // of discovery, so they are put back in order of discovery.
+      const size_t component_begin = order.size();
+      for (GraphSizeType i = component_offsets[component + 1];
+           i > component_offsets[component]; --i) {
+        order.push_back(component_members[i - 1]);
+      }
+      // For the depth first order, the successors are pushed in reverse so
+      // that the first out-neighbor is popped first from the stack.
+      const size_t component_end = order.size();
+      for (size_t i = component_begin; i < component_end; ++i) {
+        const GraphSizeType vertex =
+            order[is_depth_first ? component_begin + component_end - 1 - i
+                                 : i];
+        neighbors.clear();
+        for (const GraphSizeType neighbor : graph.GetNeighbors(vertex)) {
+          neighbors.push_back(neighbor);
+        }
+        if (is_depth_first) {
+          std::reverse(neighbors.begin(), neighbors.end());
+        }
+        for (const GraphSizeType neighbor : neighbors) {
+          const GraphSizeType neighbor_component = component_ids[neighbor];
+          if (neighbor_component != component &&
+              --in_degrees[neighbor_component] == 0) {
+            ready_components.push_back(neighbor_component);
+          }
+        }
+      }
+    }
+    assert((GraphSizeType)order.size() == num_vertices);
+  }
+
+  template <class GraphType>
+  static bool HasSelfLoop(const GraphType &graph, const GraphSizeType vertex) {
+    for (const GraphSizeType neighbor : graph.GetNeighbors(vertex)) {
+      if (neighbor == vertex) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Record the id ranges of the components with cycles, i.e. with more than
+  // one vertex or with a self-loop, given the component of each vertex. The
+  // vertices must be already numbered component by component.
+  void FindCyclicComponents(const std::vector<GraphSizeType> &component_ids) {
+    const GraphSizeType num_vertices = graph_.num_vertices;
+    cyclic_component_bounds_.clear();
+    GraphSizeType component_begin = 0;
+    for (GraphSizeType vertex = 1; vertex <= num_vertices; ++vertex) {
+      if (vertex < num_vertices &&
+          component_ids[vertex] == component_ids[component_begin]) {
+        continue;
+      }
+      if (vertex - component_begin > 1 ||
+          HasSelfLoop(graph_, component_begin)) {
+        cyclic_component_bounds_.push_back(component_begin);
+        cyclic_component_bounds_.push_back(vertex);
+      }
+      component_begin = vertex;
+    }
+    num_cyclic_components_ = cyclic_component_bounds_.size() / 2;
+    cyclic_component_bounds_view_ = cyclic_component_bounds_.data();
+  }
+
+  // Return false if the index cannot be written completely.
+  bool SaveIndex(const std::string &index_file_path) const {
+    assert(IsCompressedRepresentationGenerated());
+    SequenceGraphIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kIndexMagic, sizeof(header.magic));
+    header.version = kIndexVersion;
+    header.graph_size_type_size = sizeof(GraphSizeType);
+    header.num_vertices = graph_.num_vertices;
+    header.num_edges = graph_.GetNumEdges();
+    header.num_explicit_vertices = graph_.GetNumExplicitVertices();
+    header.num_explicit_edges =
+        graph_.explicit_offsets[header.num_explicit_vertices];
+    header.num_compacted_vertices = compacted_graph_.num_vertices;
+    header.num_compacted_edges = compacted_graph_.GetNumEdges();
+    header.num_forward_vertices = num_forward_vertices_;
+    header.num_cyclic_components = num_cyclic_components_;
+
+    std::ofstream outstrm(index_file_path, std::ios::binary);
+    if (!outstrm.is_open()) {
+      std::cerr << "Failed to open index " << index_file_path << std::endl;
+      return false;
+    }
+    WriteIndexSection(outstrm, &header, sizeof(header));
+    const size_t num_bit_words =
+        ImplicitSuccessorGraph<GraphSizeType>::GetNumBitWords(
+            header.num_vertices);
+    WriteIndexSection(outstrm, graph_.next_edge_bits,
+                      num_bit_words * sizeof(uint64_t));
+    WriteIndexSection(outstrm, graph_.explicit_edge_bits,
+                      num_bit_words * sizeof(uint64_t));
+    WriteIndexSection(outstrm, graph_.explicit_edge_ranks,
+                      num_bit_words * sizeof(GraphSizeType));
+    WriteIndexSection(
+        outstrm, graph_.explicit_offsets,
+        (header.num_explicit_vertices + 1) * sizeof(GraphSizeType));
+    WriteIndexSection(outstrm, graph_.explicit_neighbors,
+                      header.num_explicit_edges * sizeof(GraphSizeType));
+    WriteIndexSection(
+        outstrm, compacted_graph_.offsets,
+        (header.num_compacted_vertices + 1) * sizeof(GraphSizeType));
+    WriteIndexSection(outstrm, compacted_graph_.neighbors,
+                      header.num_compacted_edges * sizeof(GraphSizeType));
+    WriteIndexSection(
+        outstrm, chain_offsets_view_,
+        (header.num_compacted_vertices + 1) * sizeof(GraphSizeType));
+    WriteIndexSection(outstrm, graph_.labels, header.num_vertices);
+    WriteIndexSection(outstrm, original_vertex_ids_view_,
+                      header.num_vertices * sizeof(GraphSizeType));
+    WriteIndexSection(outstrm, vertex_ids_view_,
+                      header.num_vertices * sizeof(GraphSizeType));
+    WriteIndexSection(
+        outstrm, cyclic_component_bounds_view_,
+        header.num_cyclic_components * 2 * sizeof(GraphSizeType));
+    WriteIndexSection(outstrm, packed_labels_.GetPackedWords(),
+                      packed_labels_.GetNumPackedWords() * sizeof(uint64_t));
+    WriteIndexSection(outstrm, packed_labels_.GetExceptionMask(),
+                      packed_labels_.GetNumMaskWords() * sizeof(uint64_t));
+    outstrm.close();
+    if (outstrm.fail()) {
+      std::cerr << "Failed to write index " << index_file_path << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  static bool IsIndexFile(const std::string &file_path) {
+    char magic[sizeof(kIndexMagic)] = {0};
+    std::ifstream instrm(file_path, std::ios::binary);
+    instrm.read(magic, sizeof(magic));
+    return instrm.good() && memcmp(magic, kIndexMagic, sizeof(magic)) == 0;
+  }
+
+  // Memory map an index written by SaveIndex. The graph views, the cyclic
+  // components and the packed labels point into the read-only shared mapping,
+  // so nothing is parsed, copied or recomputed and the pages are shared
+  // between the processes using the same index. This replaces
+  // LoadFrom*File, GenerateCharLabeledGraph and
+  // GenerateCompressedRepresentation. Return false if the file is not a valid
+  // index for this GraphSizeType.
+  bool LoadIndex(const std::string &index_file_path) {
+    assert(!IsCompressedRepresentationGenerated());
+    const int fd = open(index_file_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      std::cerr << "Failed to open index " << index_file_path << std::endl;
+      return false;
+    }
+    struct stat file_stat;
+    const bool has_size = fstat(fd, &file_stat) == 0 &&
+                          (size_t)file_stat.st_size >=
+                              sizeof(SequenceGraphIndexHeader);
+    void *mapping = has_size ? mmap(nullptr, file_stat.st_size, PROT_READ,
+                                    MAP_SHARED, fd, 0)
+                             : MAP_FAILED;
+    close(fd);
+    if (mapping == MAP_FAILED) {
+      std::cerr << "Failed to map index " << index_file_path << std::endl;
+      return false;
+    }
+    index_mapping_ = mapping;
+    index_mapping_size_ = file_stat.st_size;
+
+    const char *data = (const char *)index_mapping_;
+    const SequenceGraphIndexHeader &header =
+        *(const SequenceGraphIndexHeader *)data;
+    if (memcmp(header.magic, kIndexMagic, sizeof(header.magic)) != 0 ||
+        header.version != kIndexVersion ||
+        header.graph_size_type_size != sizeof(GraphSizeType)) {
+      std::cerr << "Index " << index_file_path
+                << " is not a version " << kIndexVersion << " index with "
+                << sizeof(GraphSizeType) << "-byte vertex ids" << std::endl;
+      UnmapIndex();
+      return false;
+    }
+
+    // The counts are checked before any size or pointer is computed from them,
+    // so a corrupt header cannot overflow them.
+    const uint64_t max_count = std::numeric_limits<GraphSizeType>::max() - 1;
+    if (header.num_vertices > max_count || header.num_edges > max_count ||
+        header.num_explicit_vertices > max_count ||
+        header.num_explicit_edges > max_count ||
+        header.num_compacted_vertices > max_count ||
+        header.num_compacted_edges > max_count ||
+        header.num_forward_vertices > header.num_vertices ||
+        header.num_cyclic_components > header.num_vertices) {
+      std::cerr << "Index " << index_file_path << " has an invalid header"
+                << std::endl;
+      UnmapIndex();
+      return false;
     }
+    size_t position = 0;
+    MapIndexSection(position, 1, sizeof(header));
+    const size_t num_bit_words =
+        ImplicitSuccessorGraph<GraphSizeType>::GetNumBitWords(
+            header.num_vertices);
+    const uint64_t *next_edge_bits = (const uint64_t *)MapIndexSection(
+        position, num_bit_words, sizeof(uint64_t));
+    const uint64_t *explicit_edge_bits = (const uint64_t *)MapIndexSection(
+        position, num_bit_words, sizeof(uint64_t));
+    const GraphSizeType *explicit_edge_ranks =
+        (const GraphSizeType *)MapIndexSection(position, num_bit_words,
+                                               sizeof(GraphSizeType));
+    const GraphSizeType *explicit_offsets =
+        (const GraphSizeType *)MapIndexSection(
+            position, header.num_explicit_vertices + 1, sizeof(GraphSizeType));
+    const GraphSizeType *explicit_neighbors =
+        (const GraphSizeType *)MapIndexSection(
+            position, header.num_explicit_edges, sizeof(GraphSizeType));
+    const GraphSizeType *compacted_offsets =
+        (const GraphSizeType *)MapIndexSection(
+            position, header.num_compacted_vertices + 1,
+            sizeof(GraphSizeType));
+    const GraphSizeType *compacted_neighbors =
+        (const GraphSizeType *)MapIndexSection(
+            position, header.num_compacted_edges, sizeof(GraphSizeType));
+    const GraphSizeType *chain_offsets = (const GraphSizeType *)MapIndexSection(
+        position, header.num_compacted_vertices + 1, sizeof(GraphSizeType));
+    const char *labels =
+        MapIndexSection(position, header.num_vertices, sizeof(char));
+    const GraphSizeType *original_vertex_ids =
+        (const GraphSizeType *)MapIndexSection(position, header.num_vertices,
+                                               sizeof(GraphSizeType));
+    const GraphSizeType *vertex_ids = (const GraphSizeType *)MapIndexSection(
+        position, header.num_vertices, sizeof(GraphSizeType));
+    const GraphSizeType *cyclic_component_bounds =
+        (const GraphSizeType *)MapIndexSection(
+            position, header.num_cyclic_components, 2 * sizeof(GraphSizeType));
+    const uint64_t *packed_words = (const uint64_t *)MapIndexSection(
+        position, (header.num_vertices + 31) / 32, sizeof(uint64_t));
+    const uint64_t *exception_mask = (const uint64_t *)MapIndexSection(
+        position, (header.num_vertices + 63) / 64, sizeof(uint64_t));
+    if (position > index_mapping_size_) {
+      std::cerr << "Index " << index_file_path << " is truncated" << std::endl;
+      UnmapIndex();
+      return false;
+    }
+    // The sweeps index the layers with the component bounds.
+    uint64_t previous_component_end = 0;
+    for (uint64_t ci = 0; ci < header.num_cyclic_components; ++ci) {
+      const uint64_t component_begin = cyclic_component_bounds[2 * ci];
+      const uint64_t component_end = cyclic_component_bounds[2 * ci + 1];
+      if (previous_component_end <= component_begin &&
+          component_begin < component_end &&
+          component_end <= header.num_vertices) {
+        previous_component_end = component_end;
+        continue;
+      }
+      std::cerr << "Index " << index_file_path
+                << " has invalid cyclic components" << std::endl;
+      UnmapIndex();
+      return false;
+    }
+
+    graph_.num_vertices = header.num_vertices;
+    graph_.num_edges = header.num_edges;
+    graph_.next_edge_bits = next_edge_bits;
+    graph_.explicit_edge_bits = explicit_edge_bits;
+    graph_.explicit_edge_ranks = explicit_edge_ranks;
+    graph_.explicit_offsets = explicit_offsets;
+    graph_.explicit_neighbors = explicit_neighbors;
+    graph_.labels = labels;
+    compacted_graph_.num_vertices = header.num_compacted_vertices;
+    compacted_graph_.offsets = compacted_offsets;
+    compacted_graph_.neighbors = compacted_neighbors;
+    chain_offsets_view_ = chain_offsets;
+    original_vertex_ids_view_ = original_vertex_ids;
+    vertex_ids_view_ = vertex_ids;
+    num_forward_vertices_ = header.num_forward_vertices;
+    num_cyclic_components_ = header.num_cyclic_components;
+    cyclic_component_bounds_view_ = cyclic_component_bounds;
+    is_acyclic_ = num_cyclic_components_ == 0;
+    packed_labels_.SetView(graph_.labels, graph_.num_vertices, packed_words,
+                           exception_mask);
+    std::cerr << "# vertices: " << graph_.num_vertices
+              << ", # edges: " << graph_.GetNumEdges() << std::endl;
+    return true;
   }
 
   void SetAlignmentParameters(const ScoreType substitution_penalty,
@@ -97,6 +714,13 @@ class SequenceGraph {
     insertion_penalty_ = insertion_penalty;
   }
 
+  // The RECOMB and Navarro aligners compute the layers with a sweep over the
+  // strongly connected components by default. Disabling it uses their kernels
+  // for general graphs, which give the same costs.
+  void SetComponentSweep(const bool use_component_sweep) {
+    use_component_sweep_ = use_component_sweep;
+  }
+
   void AddReverseComplementaryVertexIfNecessary(
       const gfa_t *gfa_graph, uint32_t gfa_vertex_id,
       std::vector<GraphSizeType> &reverse_complementary_compacted_vertex_id) {
@@ -276,8 +900,17 @@ class SequenceGraph {
     std::ofstream outstrm(output_file_path);
     outstrm << "H\tVN:Z:1.0\n";
     // Both for loops start from 1 to skip the dummy vertex.
-    for (uint32_t i = 1; i < labels_.size(); ++i) {
-      outstrm << "S\t" << i << "\t" << labels_[i] << "\n";
+    for (GraphSizeType i = 1; i < GetNumVertices(); ++i) {
+      outstrm << "S\t" << i << "\t" << GetVertexLabel(i) << "\n";
+    }
+
+    if (IsCompressedRepresentationGenerated()) {
+      for (GraphSizeType i = 1; i < graph_.num_vertices; ++i) {
+        for (const GraphSizeType neighbor : graph_.GetNeighbors(i)) {
+          outstrm << "L\t" << i << "\t+\t" << neighbor << "\t+\t0M\n";
+        }
+      }
+      return;
     }
 
     for (uint32_t i = 1; i < adjacency_list_.size(); ++i) {
@@ -349,55 +982,338 @@ class SequenceGraph {
   }
 
   inline char GetReverseComplementaryVertexLabel(GraphSizeType vertex) const {
-    return base_complement_[(int)labels_[vertex]];
+    return base_complement_[(int)graph_.labels[vertex]];
   }
 
   inline char GetVertexLabel(GraphSizeType vertex) const {
-    return labels_[vertex];
+    return graph_.labels[vertex];
   }
 
+  // Append the reverse complementary strand to the char labeled graph, so
+  // that the aligners cover both strands of a read in a single pass instead
+  // of aligning the read and its reverse complement separately. Each vertex
+  // but vertex 0 gets a copy with the complementary label and the reversed
+  // edges. It should be called after GenerateCharLabeledGraph and before
+  // GenerateCompressedRepresentation.
   void GenerateReverseComplementaryCharLabeledGraph() {
-    reverse_complementary_adjacency_list_.assign(adjacency_list_.size(),
-                                                 std::vector<GraphSizeType>());
-    for (GraphSizeType vertex = 0; vertex < adjacency_list_.size(); ++vertex) {
+    assert(!IsBidirected() && !IsCompressedRepresentationGenerated());
+    const GraphSizeType num_forward_vertices = labels_.size();
+    num_forward_vertices_ = num_forward_vertices;
+    // The copy of vertex v is vertex num_forward_vertices + v - 1.
+    const GraphSizeType offset = num_forward_vertices - 1;
+    labels_.reserve(2 * num_forward_vertices - 1);
+    adjacency_list_.resize(2 * num_forward_vertices - 1);
+    for (GraphSizeType vertex = 1; vertex < num_forward_vertices; ++vertex) {
+      labels_.push_back(base_complement_[(int)labels_[vertex]]);
       for (const GraphSizeType neighbor : adjacency_list_[vertex]) {
-        reverse_complementary_adjacency_list_[neighbor].push_back(vertex);
+        adjacency_list_[neighbor + offset].push_back(vertex + offset);
+      }
+    }
+  }
+
+  // Get the min cost of the layer on each strand of a bidirected graph. Vertex
+  // 0 counts for both strands, as in two separate passes.
+  template <class LayerValueType>
+  void GetMinCostOnEachStrand(const std::vector<LayerValueType> &layer,
+                              LayerValueType &forward_cost,
+                              LayerValueType &reverse_complement_cost) const {
+    forward_cost = layer[0];
+    reverse_complement_cost = layer[0];
+    for (GraphSizeType vertex = 1; vertex < graph_.num_vertices; ++vertex) {
+      LayerValueType &cost = IsReverseComplementaryVertex(vertex)
+                                 ? reverse_complement_cost
+                                 : forward_cost;
+      if (layer[vertex] < cost) {
+        cost = layer[vertex];
       }
     }
   }
 
-  void PropagateInsertions(const std::vector<ScoreType> &initialized_layer,
-                           const std::vector<GraphSizeType> &initialized_order,
+  // Relax the out-edges of a vertex whose cell in the current layer is final,
+  // for both the matches or substitutions from the previous layer and the
+  // insertions in the current layer. Only the out-neighbors with ids from
+  // neighbor_begin on are relaxed.
+  template <class LayerValueType>
+  void RelaxOutEdges(const GraphSizeType vertex,
+                     const GraphSizeType neighbor_begin,
+                     const uint64_t *mismatch_mask,
+                     const std::vector<LayerValueType> &previous_layer,
+                     std::vector<LayerValueType> &current_layer) const {
+    const LayerValueType insertion_distance =
+        current_layer[vertex] + insertion_penalty_;
+    for (const GraphSizeType neighbor : graph_.GetNeighbors(vertex)) {
+      if (neighbor >= neighbor_begin) {
+        RelaxEdge(vertex, neighbor, insertion_distance, mismatch_mask,
+                  previous_layer, current_layer);
+      }
+    }
+  }
+
+  template <class LayerValueType>
+  void RelaxEdge(const GraphSizeType vertex, const GraphSizeType neighbor,
+                 const LayerValueType insertion_distance,
+                 const uint64_t *mismatch_mask,
+                 const std::vector<LayerValueType> &previous_layer,
+                 std::vector<LayerValueType> &current_layer) const {
+    LayerValueType distance = previous_layer[vertex];
+    if (PackedLabels::IsMismatch(mismatch_mask, neighbor)) {
+      distance += substitution_penalty_;
+    }
+    if (distance > insertion_distance) {
+      distance = insertion_distance;
+    }
+    if (current_layer[neighbor] > distance) {
+      current_layer[neighbor] = distance;
+    }
+  }
+
+  // Compute a layer as a sweep over the strongly connected components in
+  // topological order, see RenumberVertices. The in-neighbors of a vertex out
+  // of any cycle all have smaller ids, so its cell is final when it is reached
+  // and the insertions are pushed along its out-edges in the same sweep,
+  // without any queue, sorting or visited flags. For a component with cycles,
+  // the insertions are propagated inside the component with a bucket queue
+  // before its out-edges leaving the component are relaxed. Return the min
+  // cost of the layer, taken over the cells as they become final.
+  template <class LayerValueType>
+  LayerValueType ComputeLayerOnCondensedGraph(
+      const char sequence_base,
+      const std::vector<LayerValueType> &previous_layer,
+      std::vector<LayerValueType> &current_layer, Workspace &workspace) const {
+    const GraphSizeType num_vertices = graph_.num_vertices;
+
+    workspace.mismatch_mask_.resize(packed_labels_.GetNumMaskWords());
+    const uint64_t *mismatch_mask = workspace.mismatch_mask_.data();
+    packed_labels_.InitializeRow(
+        sequence_base, previous_layer[0], (LayerValueType)substitution_penalty_,
+        workspace.mismatch_mask_.data(), current_layer.data());
+    current_layer[0] = previous_layer[0] + deletion_penalty_;
+    LayerValueType min_cost = current_layer[0];
+
+    GraphSizeType i = 1;
+    for (GraphSizeType component_index = 0;
+         component_index <= num_cyclic_components_; ++component_index) {
+      const GraphSizeType component_begin =
+          component_index < num_cyclic_components_
+              ? cyclic_component_bounds_view_[2 * component_index]
+              : num_vertices;
+      // The vertices are streamed along the unitigs: the implicit edge to the
+      // next vertex is checked by its bit and the explicit edges are read in
+      // order, without looking up the neighbors of each vertex.
+      GraphSizeType explicit_rank =
+          i < component_begin ? graph_.GetExplicitEdgeRank(i) : 0;
+      for (; i < component_begin; ++i) {
+        if (current_layer[i] > previous_layer[i] + deletion_penalty_) {
+          current_layer[i] = previous_layer[i] + deletion_penalty_;
+        }
+        if (min_cost > current_layer[i]) {
+          min_cost = current_layer[i];
+        }
+        const LayerValueType insertion_distance =
+            current_layer[i] + insertion_penalty_;
+        if (graph_.HasNextEdge(i)) {
+          RelaxEdge(i, i + 1, insertion_distance, mismatch_mask,
+                    previous_layer, current_layer);
+        }
+        if (graph_.HasExplicitEdges(i)) {
+          const GraphSizeType *neighbor =
+              graph_.explicit_neighbors +
+              graph_.explicit_offsets[explicit_rank];
+          const GraphSizeType *last_neighbor =
+              graph_.explicit_neighbors +
+              graph_.explicit_offsets[explicit_rank + 1];
+          for (; neighbor != last_neighbor; ++neighbor) {
+            RelaxEdge(i, *neighbor, insertion_distance, mismatch_mask,
+                      previous_layer, current_layer);
+          }
+          ++explicit_rank;
+        }
+      }
+      if (component_begin == num_vertices) {
+        break;
+      }
+
+      const GraphSizeType component_end =
+          cyclic_component_bounds_view_[2 * component_index + 1];
+      // Deletions and the matches or substitutions along the edges inside the
+      // component. The edges from the previous components are relaxed
+      // already.
+      for (GraphSizeType vertex = component_begin; vertex < component_end;
+           ++vertex) {
+        const LayerValueType deletion_distance =
+            previous_layer[vertex] + deletion_penalty_;
+        if (current_layer[vertex] > deletion_distance) {
+          current_layer[vertex] = deletion_distance;
+        }
+      }
+      for (GraphSizeType vertex = component_begin; vertex < component_end;
+           ++vertex) {
+        for (const GraphSizeType neighbor : graph_.GetNeighbors(vertex)) {
+          if (neighbor >= component_end) {
+            continue;
+          }
+          LayerValueType distance = previous_layer[vertex];
+          if (PackedLabels::IsMismatch(mismatch_mask, neighbor)) {
+            distance += substitution_penalty_;
+          }
+          if (current_layer[neighbor] > distance) {
+            current_layer[neighbor] = distance;
+          }
+        }
+      }
+
+      // Insertions inside the component, in increasing order of distances.
+      workspace.propagation_queue_.Clear();
+      for (GraphSizeType vertex = component_begin; vertex < component_end;
+           ++vertex) {
+        for (const GraphSizeType neighbor : graph_.GetNeighbors(vertex)) {
+          const LayerValueType insertion_distance =
+              current_layer[vertex] + insertion_penalty_;
+          if (neighbor < component_end &&
+              current_layer[neighbor] > insertion_distance) {
+            current_layer[neighbor] = insertion_distance;
+            workspace.propagation_queue_.Push(
+                (QueryLengthType)current_layer[neighbor], neighbor);
+          }
+        }
+      }
+      while (!workspace.propagation_queue_.Empty()) {
+        QueryLengthType distance = 0;
+        const GraphSizeType vertex = workspace.propagation_queue_.Pop(distance);
+        // Skip the stale entries of the vertices improved after being pushed.
+        if ((QueryLengthType)current_layer[vertex] != distance) {
+          continue;
+        }
+        for (const GraphSizeType neighbor : graph_.GetNeighbors(vertex)) {
+          if (neighbor < component_end &&
+              current_layer[neighbor] > distance + insertion_penalty_) {
+            current_layer[neighbor] = distance + insertion_penalty_;
+            workspace.propagation_queue_.Push(
+                (QueryLengthType)current_layer[neighbor], neighbor);
+          }
+        }
+      }
+
+      // The cells of the component are final, so push them to the next
+      // components.
+      for (GraphSizeType vertex = component_begin; vertex < component_end;
+           ++vertex) {
+        if (min_cost > current_layer[vertex]) {
+          min_cost = current_layer[vertex];
+        }
+        RelaxOutEdges(vertex, component_end, mismatch_mask, previous_layer,
+                      current_layer);
+      }
+      i = component_end;
+    }
+    return min_cost;
+  }
+
+  // Align the sequence and its reverse complement with
+  // ComputeLayerOnCondensedGraph. The costs are the same as the ones of
+  // AlignUsingLinearGapPenalty.
+  ScoreType AlignUsingLinearGapPenaltyOnCondensedGraph(
+      const sga::Sequence &sequence, Workspace &workspace,
+      const ScoreType max_cost) const {
+    const GraphSizeType num_vertices = graph_.num_vertices;
+    const QueryLengthType sequence_length = sequence.GetLength();
+    const StringView sequence_bases = sequence.GetSequence();
+    std::vector<ScoreType> &previous_layer = workspace.previous_layer_;
+    std::vector<ScoreType> &current_layer = workspace.current_layer_;
+    previous_layer.resize(num_vertices);
+    current_layer.assign(num_vertices, 0);
+
+    // The min of a layer never decreases from one layer to the next, so once
+    // it is above max_cost, so is the alignment cost and the remaining layers
+    // are skipped.
+    ScoreType min_cost = 0;
+    for (QueryLengthType i = 0; i < sequence_length && min_cost <= max_cost;
+         ++i) {
+      std::swap(previous_layer, current_layer);
+      min_cost = ComputeLayerOnCondensedGraph(sequence_bases[i], previous_layer,
+                                              current_layer, workspace);
+    }
+
+    ScoreType forward_alignment_cost = 0;
+    ScoreType reverse_complement_alignment_cost = 0;
+    if (IsBidirected()) {
+      GetMinCostOnEachStrand(current_layer, forward_alignment_cost,
+                             reverse_complement_alignment_cost);
+    } else {
+      forward_alignment_cost = min_cost;
+
+      // For reverse complement, which only matters if it is below the
+      // forward cost.
+      const ScoreType reverse_complement_max_cost =
+          std::min(max_cost, forward_alignment_cost);
+      current_layer.assign(num_vertices, 0);
+
+      min_cost = 0;
+      for (QueryLengthType i = 0;
+           i < sequence_length && min_cost <= reverse_complement_max_cost;
+           ++i) {
+        std::swap(previous_layer, current_layer);
+        min_cost = ComputeLayerOnCondensedGraph(
+            base_complement_[(int)sequence_bases[sequence_length - 1 - i]],
+            previous_layer, current_layer, workspace);
+      }
+
+      reverse_complement_alignment_cost = min_cost;
+    }
+
+    const ScoreType min_alignment_cost =
+        std::min(forward_alignment_cost, reverse_complement_alignment_cost);
+    return min_alignment_cost;
+  }
+
+  // Propagate the insertions in place in the initialized layer, visiting the
+  // vertices in increasing order of costs by merging the initialized order
+  // with the FIFO of updated vertices. The visited vertices are the ones
+  // stamped with the epoch of the row, so nothing is cleared per row.
+  void PropagateInsertions(const std::vector<GraphSizeType> &initialized_order,
                            std::vector<ScoreType> &current_layer,
-                           std::vector<GraphSizeType> &current_order) {
-    const GraphSizeType num_vertices = GetNumVertices();
+                           std::vector<GraphSizeType> &current_order,
+                           Workspace &workspace) const {
+    const GraphSizeType num_vertices = graph_.num_vertices;
     GraphSizeType initialized_order_index = 0;
     GraphSizeType current_order_index = 0;
-    visited_.assign(num_vertices, false);
+    std::vector<uint32_t> &visited_epochs = workspace.visited_epochs_;
+    if (visited_epochs.size() < (size_t)num_vertices) {
+      visited_epochs.resize(num_vertices, 0);
+    }
+    if (++workspace.visited_epoch_ == 0) {
+      std::fill(visited_epochs.begin(), visited_epochs.end(), 0);
+      workspace.visited_epoch_ = 1;
+    }
+    const uint32_t visited_epoch = workspace.visited_epoch_;
 
-    std::deque<GraphSizeType> updated_neighbors;
+    std::vector<GraphSizeType> &updated_neighbors =
+        workspace.updated_neighbors_;
+    size_t &updated_neighbors_head = workspace.updated_neighbors_head_;
+    updated_neighbors.clear();
+    updated_neighbors_head = 0;
 
     while (initialized_order_index < num_vertices ||
-           !updated_neighbors.empty()) {
+           updated_neighbors_head < updated_neighbors.size()) {
       GraphSizeType min_vertex = num_vertices;
 
       if (initialized_order_index < num_vertices &&
-          (updated_neighbors.empty() ||
+          (updated_neighbors_head == updated_neighbors.size() ||
            current_layer[initialized_order[initialized_order_index]] <
-               current_layer[updated_neighbors.front()])) {
+               current_layer[updated_neighbors[updated_neighbors_head]])) {
         min_vertex = initialized_order[initialized_order_index];
         ++initialized_order_index;
       } else {
-        min_vertex = updated_neighbors.front();
-        updated_neighbors.pop_front();
+        min_vertex = updated_neighbors[updated_neighbors_head];
+        ++updated_neighbors_head;
       }
 
-      if (!visited_[min_vertex]) {
-        visited_[min_vertex] = true;
+      if (visited_epochs[min_vertex] != visited_epoch) {
+        visited_epochs[min_vertex] = visited_epoch;
         current_order[current_order_index] = min_vertex;
         ++current_order_index;
-        for (const auto &neighbor : adjacency_list_[min_vertex]) {
-          if (!visited_[neighbor] &&
+        for (const GraphSizeType neighbor : graph_.GetNeighbors(min_vertex)) {
+          if (visited_epochs[neighbor] != visited_epoch &&
               current_layer[neighbor] >
                   current_layer[min_vertex] + insertion_penalty_) {
             current_layer[neighbor] =
@@ -409,455 +1325,1211 @@ class SequenceGraph {
     }
   }
 
-  // Build the order look up table.
-  void BuildOrderLookUpTable(const std::vector<ScoreType> &previous_layer,
-                             const std::vector<GraphSizeType> &previous_order) {
-    const GraphSizeType num_vertices = GetNumVertices();
-    GraphSizeType match_index = 0, substitution_index = 0, deletion_index = 0;
-    GraphSizeType count = 0;
-
-    while (count < 3 * num_vertices) {
-      // Find the min.
-      ScoreType min_distance =
-          previous_layer[previous_order[num_vertices - 1]] +
-          substitution_penalty_ + deletion_penalty_ + 1;
-      int min_type = -1;  // 0 for match, 1 for substitution, 2 for deletion.
-      if (match_index < num_vertices &&
-          previous_layer[previous_order[match_index]] < min_distance) {
-        min_distance = previous_layer[previous_order[match_index]];
-        min_type = 0;
-      }
-
-      if (substitution_index < num_vertices &&
-          previous_layer[previous_order[substitution_index]] +
-                  substitution_penalty_ <
-              min_distance) {
-        min_distance = previous_layer[previous_order[substitution_index]] +
-                       substitution_penalty_;
-        min_type = 1;
-      }
-
-      if (deletion_index < num_vertices &&
-          previous_layer[previous_order[deletion_index]] + deletion_penalty_ <
-              min_distance) {
-        min_distance =
-            previous_layer[previous_order[deletion_index]] + deletion_penalty_;
-        min_type = 2;
-      }
-
-      // Put the order of min into the look up table.
-      if (min_type == 0) {
-        order_look_up_table_[min_type * num_vertices +
-                             previous_order[match_index]] = count;
-        ++match_index;
-      } else if (min_type == 1) {
-        order_look_up_table_[min_type * num_vertices +
-                             previous_order[substitution_index]] = count;
-        ++substitution_index;
-      } else {
-        order_look_up_table_[min_type * num_vertices +
-                             previous_order[deletion_index]] = count;
-        ++deletion_index;
-      }
-
-      ++count;
-    }
-  }
-
-  void InitializeDistancesWithSorting(
-      const char sequence_base, const std::vector<ScoreType> &previous_layer,
-      const std::vector<GraphSizeType> &previous_order,
-      std::vector<ScoreType> &initialized_layer,
-      std::vector<GraphSizeType> &initialized_order) {
-    const GraphSizeType num_vertices = GetNumVertices();
-
-    // Initialize the layer.
-    initialized_layer[0] = previous_layer[0] + deletion_penalty_;
-    for (GraphSizeType j = 1; j < num_vertices; ++j) {
-      ScoreType cost = 0;
-      if (sequence_base != labels_[j]) {
-        cost = substitution_penalty_;
-      }
-      initialized_layer[j] = previous_layer[0] + cost;
-    }
-
-    for (GraphSizeType i = 1; i < num_vertices; ++i) {
-      if (initialized_layer[i] > previous_layer[i] + deletion_penalty_) {
-        initialized_layer[i] = previous_layer[i] + deletion_penalty_;
-      }
-
-      for (const auto &neighbor : adjacency_list_[i]) {
-        ScoreType cost = 0;
-
-        if (sequence_base != labels_[neighbor]) {
-          cost = substitution_penalty_;
-        }
-
-        if (initialized_layer[neighbor] > previous_layer[i] + cost) {
-          initialized_layer[neighbor] = previous_layer[i] + cost;
-        }
-      }
-    }
-
-    // Use sorting to get order.
-    for (GraphSizeType vertex = 0; vertex < num_vertices; ++vertex) {
-      distances_with_vertices_[vertex] =
-          std::make_pair((*initialized_layer)[vertex], vertex);
-    }
-    std::sort(distances_with_vertices_.begin(), distances_with_vertices_.end());
-    for (GraphSizeType i = 0; i < num_vertices; ++i) {
-      initialized_order[i] = distances_with_vertices_[i].second;
-    }
-  }
-
+  // Initialize the layer with the matches, substitutions and deletions from
+  // the previous layer, then order the vertices by their initialized costs.
+  // The costs of a layer are small integers in a narrow range, so the order is
+  // a counting sort over the costs: one histogram pass and one scatter pass
+  // over the vertices, with ties in increasing order of vertex ids.
   void InitializeDistances(const char sequence_base,
                            const std::vector<ScoreType> &previous_layer,
-                           const std::vector<GraphSizeType> &previous_order,
                            std::vector<ScoreType> &initialized_layer,
-                           std::vector<GraphSizeType> &initialized_order) {
-    const GraphSizeType num_vertices = GetNumVertices();
-    BuildOrderLookUpTable(previous_layer, previous_order);
+                           std::vector<GraphSizeType> &initialized_order,
+                           Workspace &workspace) const {
+    const GraphSizeType num_vertices = graph_.num_vertices;
 
     // Initialize the layer
+    workspace.mismatch_mask_.resize(packed_labels_.GetNumMaskWords());
+    const uint64_t *mismatch_mask = workspace.mismatch_mask_.data();
+    packed_labels_.InitializeRow(
+        sequence_base, (ScoreType)previous_layer[0], substitution_penalty_,
+        workspace.mismatch_mask_.data(), initialized_layer.data());
     initialized_layer[0] = previous_layer[0] + deletion_penalty_;
-    parents_[0] = 0;
-    types_[0] = 2;
-
-    for (GraphSizeType j = 1; j < num_vertices; ++j) {
-      ScoreType cost = 0;
-      int type = 0;
-      if (sequence_base != labels_[j]) {
-        cost = substitution_penalty_;
-        type = 1;
-      }
-      initialized_layer[j] = previous_layer[0] + cost;
-      parents_[j] = 0;
-      types_[j] = type;
-    }
 
     for (GraphSizeType i = 1; i < num_vertices; ++i) {
       if (initialized_layer[i] > previous_layer[i] + deletion_penalty_) {
         initialized_layer[i] = previous_layer[i] + deletion_penalty_;
-        parents_[i] = i;
-        types_[i] = 2;
       }
 
-      for (const auto &neighbor : adjacency_list_[i]) {
+      for (const GraphSizeType neighbor : graph_.GetNeighbors(i)) {
         ScoreType cost = 0;
-        int type = 0;
 
-        if (sequence_base != labels_[neighbor]) {
+        if (PackedLabels::IsMismatch(mismatch_mask, neighbor)) {
           cost = substitution_penalty_;
-          type = 1;
         }
 
         if (initialized_layer[neighbor] > previous_layer[i] + cost) {
           initialized_layer[neighbor] = previous_layer[i] + cost;
-          parents_[neighbor] = i;
-          types_[neighbor] = type;
         }
       }
     }
 
-    // Get the order. One should notice there can be multiple vertices share the
-    // same parent and type.
-    order_offsets_.assign(3 * num_vertices + 1, 0);
-    order_counts_.assign(3 * num_vertices, 0);
+    // Get the order.
+    const ScoreType min_distance =
+        *std::min_element(initialized_layer.begin(), initialized_layer.end());
+    const ScoreType max_distance =
+        *std::max_element(initialized_layer.begin(), initialized_layer.end());
+    std::vector<GraphSizeType> &bucket_offsets =
+        workspace.distance_bucket_offsets_;
+    bucket_offsets.assign(max_distance - min_distance + 2, 0);
 
     for (GraphSizeType i = 0; i < num_vertices; ++i) {
-      order_offsets_
-          [order_look_up_table_[types_[i] * num_vertices + parents_[i]] + 1]++;
+      ++bucket_offsets[initialized_layer[i] - min_distance + 1];
     }
 
-    for (GraphSizeType i = 1; i < 3 * num_vertices + 1; ++i) {
-      order_offsets_[i] += order_offsets_[i - 1];
+    for (size_t i = 1; i < bucket_offsets.size(); ++i) {
+      bucket_offsets[i] += bucket_offsets[i - 1];
     }
 
     for (GraphSizeType i = 0; i < num_vertices; ++i) {
-      const GraphSizeType order =
-          order_look_up_table_[types_[i] * num_vertices + parents_[i]];
-      initialized_order[order_offsets_[order] + order_counts_[order]] = i;
-      ++order_counts_[order];
+      initialized_order[bucket_offsets[initialized_layer[i] - min_distance]++] =
+          i;
     }
   }
 
-  ScoreType AlignUsingLinearGapPenalty(const sga::Sequence &sequence) {
-    ScoreType max_cost = std::max(
-        std::max(substitution_penalty_, deletion_penalty_), insertion_penalty_);
-    const GraphSizeType num_vertices = GetNumVertices();
+  // Align the sequence and its reverse complement. If the cost is above
+  // max_cost, the alignment may stop early and return any cost above
+  // max_cost. The cost of the first strand bounds the second one in the same
+  // way.
+  ScoreType AlignUsingLinearGapPenalty(
+      const sga::Sequence &sequence, Workspace &workspace,
+      const ScoreType max_cost = std::numeric_limits<ScoreType>::max()) const {
+    assert(IsCompressedRepresentationGenerated());
+    if (use_component_sweep_) {
+      return AlignUsingLinearGapPenaltyOnCondensedGraph(sequence, workspace,
+                                                        max_cost);
+    }
+    const GraphSizeType num_vertices = graph_.num_vertices;
     const QueryLengthType sequence_length = sequence.GetLength();
-    const std::string &sequence_bases = sequence.GetSequence();
-
-    std::vector<ScoreType> previous_layer(num_vertices);
-    std::vector<GraphSizeType> previous_order(num_vertices);
-    std::vector<ScoreType> initialized_layer(num_vertices,
-                                             sequence_length * max_cost + 1);
-    std::vector<GraphSizeType> initialized_order(num_vertices);
-    std::vector<ScoreType> current_layer(num_vertices, 0);
-    std::vector<GraphSizeType> current_order;
-    current_order.reserve(num_vertices);
+    const StringView sequence_bases = sequence.GetSequence();
+
+    // The layers and the orders are ping-pong buffers: each row is
+    // initialized in the buffer of the row before the previous one and the
+    // insertions are propagated in place, so no layer is copied.
+    std::vector<ScoreType> &previous_layer = workspace.previous_layer_;
+    std::vector<GraphSizeType> &previous_order = workspace.previous_order_;
+    std::vector<GraphSizeType> &initialized_order =
+        workspace.initialized_order_;
+    std::vector<ScoreType> &current_layer = workspace.current_layer_;
+    std::vector<GraphSizeType> &current_order = workspace.current_order_;
+
+    previous_layer.resize(num_vertices);
+    previous_order.resize(num_vertices);
+    initialized_order.resize(num_vertices);
+    current_layer.assign(num_vertices, 0);
+    current_order.resize(num_vertices);
 
     for (GraphSizeType i = 0; i < num_vertices; ++i) {
-      current_order.push_back(i);
+      current_order[i] = i;
     }
 
-    order_look_up_table_.assign(3 * num_vertices, 0);
-    parents_.assign(num_vertices, 0);
-    types_.assign(num_vertices, 0);
-    // distances_with_vertices_.assign(num_vertices, std::make_pair(0,0));
-
     for (QueryLengthType i = 0; i < sequence_length; ++i) {
       std::swap(previous_layer, current_layer);
       std::swap(previous_order, current_order);
-      InitializeDistances(sequence_bases[i], previous_layer, previous_order,
-                          initialized_layer, initialized_order);
-      // InitializeDistancesWithSorting(sequence_bases[i], previous_layer,
-      // previous_order, &initialized_layer, &initialized_order);
-      current_layer = initialized_layer;
-      PropagateInsertions(initialized_layer, initialized_order, current_layer,
-                          current_order);
+      InitializeDistances(sequence_bases[i], previous_layer, current_layer,
+                          initialized_order, workspace);
+      PropagateInsertions(initialized_order, current_layer, current_order,
+                          workspace);
+      // The first vertex in the order has the min cost of the layer.
+      if (current_layer[current_order[0]] > max_cost) {
+        break;
+      }
     }
 
-    const ScoreType forward_alignment_cost = current_layer[current_order[0]];
-
-    // For reverse complement.
-    initialized_layer.assign(num_vertices, sequence_length * max_cost + 1);
-    current_layer.assign(num_vertices, 0);
+    ScoreType forward_alignment_cost = current_layer[current_order[0]];
+    ScoreType reverse_complement_alignment_cost = forward_alignment_cost;
+    if (IsBidirected()) {
+      GetMinCostOnEachStrand(current_layer, forward_alignment_cost,
+                             reverse_complement_alignment_cost);
+    } else {
+      // For reverse complement, which only matters if it is below the
+      // forward cost.
+      const ScoreType reverse_complement_max_cost =
+          std::min(max_cost, forward_alignment_cost);
+      std::fill(current_layer.begin(), current_layer.end(), 0);
+
+      for (GraphSizeType i = 0; i < num_vertices; ++i) {
+        current_order[i] = i;
+      }
 
-    for (GraphSizeType i = 0; i < num_vertices; ++i) {
-      current_order[i] = i;
-    }
+      for (QueryLengthType i = 0; i < sequence_length; ++i) {
+        std::swap(previous_layer, current_layer);
+        std::swap(previous_order, current_order);
+        InitializeDistances(
+            base_complement_[(int)sequence_bases[sequence_length - 1 - i]],
+            previous_layer, current_layer, initialized_order, workspace);
+        PropagateInsertions(initialized_order, current_layer, current_order,
+                            workspace);
+        if (current_layer[current_order[0]] > reverse_complement_max_cost) {
+          break;
+        }
+      }
 
-    for (QueryLengthType i = 0; i < sequence_length; ++i) {
-      std::swap(previous_layer, current_layer);
-      std::swap(previous_order, current_order);
-      InitializeDistances(
-          base_complement_[(int)sequence_bases[sequence_length - 1 - i]],
-          previous_layer, previous_order, initialized_layer, initialized_order);
-      // InitializeDistancesWithSorting(base_complement_[sequence_bases[sequence_length
-      // - 1 - i]], previous_layer, previous_order, &initialized_layer,
-      // &initialized_order);
-      current_layer = initialized_layer;
-      PropagateInsertions(initialized_layer, initialized_order, current_layer,
-                          current_order);
+      reverse_complement_alignment_cost = current_layer[current_order[0]];
     }
 
-    const ScoreType reverse_complement_alignment_cost =
-        current_layer[current_order[0]];
-
     const ScoreType min_alignment_cost =
         std::min(forward_alignment_cost, reverse_complement_alignment_cost);
-
-    std::cerr << "Sequence length: " << sequence_length
-              << ", forward alignment cost:" << forward_alignment_cost
-              << ", reverse complement alignment cost:"
-              << reverse_complement_alignment_cost
-              << ", alignment cost:" << min_alignment_cost << std::endl;
     return min_alignment_cost;
   }
 
+  // Same as above but uses the workspace owned by the graph, thus it is not
+  // thread-safe.
+  ScoreType AlignUsingLinearGapPenalty(
+      const sga::Sequence &sequence,
+      const ScoreType max_cost = std::numeric_limits<ScoreType>::max()) {
+    return AlignUsingLinearGapPenalty(sequence, default_workspace_, max_cost);
+  }
+
+  // Propagate the insertions along the edges in the current layer until no
+  // cell can be improved. The seeds are the cells improved by one of their
+  // in-neighbors. Then the vertices are settled in increasing order of their
+  // distances with a bucket queue, so each improved vertex is expanded once
+  // and no recursion is needed.
   void PropagateWithNavarroAlgorithm(
-      const GraphSizeType from, const GraphSizeType to,
-      GraphSizeType &num_propagations,
-      std::vector<QueryLengthType> &current_layer) {
-    num_propagations += 1;
-    if (current_layer[to] > insertion_penalty_ + current_layer[from]) {
-      current_layer[to] = insertion_penalty_ + current_layer[from];
-      for (const auto &neighbor : adjacency_list_[to]) {
-        PropagateWithNavarroAlgorithm(to, neighbor, num_propagations,
-                                      current_layer);
+      std::vector<QueryLengthType> &current_layer,
+      Workspace &workspace) const {
+    const GraphSizeType num_vertices = graph_.num_vertices;
+    workspace.propagation_queue_.Clear();
+
+    for (GraphSizeType i = 1; i < num_vertices; ++i) {
+      for (const GraphSizeType neighbor : graph_.GetNeighbors(i)) {
+        if (current_layer[neighbor] > insertion_penalty_ + current_layer[i]) {
+          current_layer[neighbor] = insertion_penalty_ + current_layer[i];
+          workspace.propagation_queue_.Push(current_layer[neighbor], neighbor);
+        }
+      }
+    }
+
+    while (!workspace.propagation_queue_.Empty()) {
+      QueryLengthType distance = 0;
+      const GraphSizeType vertex = workspace.propagation_queue_.Pop(distance);
+      // Skip the stale entries of the vertices improved after being pushed.
+      if (current_layer[vertex] != distance) {
+        continue;
+      }
+
+      for (const GraphSizeType neighbor : graph_.GetNeighbors(vertex)) {
+        if (current_layer[neighbor] > insertion_penalty_ + distance) {
+          current_layer[neighbor] = insertion_penalty_ + distance;
+          workspace.propagation_queue_.Push(current_layer[neighbor], neighbor);
+        }
       }
     }
   }
 
-  void ComputeLayerWithNavarroAlgorithm(
+  // Return the min cost of the layer. The insertions only add to the cells
+  // they start from, so it is the min before they are propagated, taken over
+  // the cells as they are lowered.
+  QueryLengthType ComputeLayerWithNavarroAlgorithm(
       const char sequence_base,
       const std::vector<QueryLengthType> &previous_layer,
-      GraphSizeType &num_propagations,
-      std::vector<QueryLengthType> &current_layer) {
-    const GraphSizeType num_vertices = GetNumVertices();
+      std::vector<QueryLengthType> &current_layer,
+      Workspace &workspace) const {
+    if (use_component_sweep_) {
+      return ComputeLayerOnCondensedGraph(sequence_base, previous_layer,
+                                          current_layer, workspace);
+    }
+    const GraphSizeType num_vertices = graph_.num_vertices;
 
     // Initialize current layer
+    workspace.mismatch_mask_.resize(packed_labels_.GetNumMaskWords());
+    const uint64_t *mismatch_mask = workspace.mismatch_mask_.data();
+    packed_labels_.InitializeRow(
+        sequence_base, previous_layer[0],
+        (QueryLengthType)substitution_penalty_, workspace.mismatch_mask_.data(),
+        current_layer.data());
     current_layer[0] = previous_layer[0] + deletion_penalty_;
-    for (GraphSizeType j = 1; j < num_vertices; ++j) {
-      QueryLengthType cost = 0;
-
-      if (sequence_base != labels_[j]) {
-        cost = substitution_penalty_;
-      }
-
-      current_layer[j] = previous_layer[0] + cost;
-    }
+    QueryLengthType min_cost = current_layer[0];
 
     for (GraphSizeType i = 1; i < num_vertices; ++i) {
       if (current_layer[i] > previous_layer[i] + deletion_penalty_) {
         current_layer[i] = previous_layer[i] + deletion_penalty_;
       }
+      min_cost = std::min(min_cost, current_layer[i]);
 
-      for (const auto &neighbor : adjacency_list_[i]) {
+      for (const GraphSizeType neighbor : graph_.GetNeighbors(i)) {
         QueryLengthType cost = 0;
 
-        if (sequence_base != labels_[neighbor]) {
+        if (PackedLabels::IsMismatch(mismatch_mask, neighbor)) {
           cost = substitution_penalty_;
         }
 
         if (current_layer[neighbor] > previous_layer[i] + cost) {
           current_layer[neighbor] = previous_layer[i] + cost;
+          min_cost = std::min(min_cost, current_layer[neighbor]);
         }
       }
     }
 
-    for (GraphSizeType i = 1; i < num_vertices; ++i) {
-      for (const auto &neighbor : adjacency_list_[i]) {
-        PropagateWithNavarroAlgorithm(i, neighbor, num_propagations,
-                                      current_layer);
-      }
-    }
+    PropagateWithNavarroAlgorithm(current_layer, workspace);
+    return min_cost;
   }
 
+  // Align the sequence and its reverse complement with Navarro's algorithm.
+  // max_cost bounds the cost as in AlignUsingLinearGapPenalty.
   QueryLengthType AlignUsingLinearGapPenaltyWithNavarroAlgorithm(
-      const sga::Sequence &sequence) {
-    QueryLengthType max_cost = std::max(
+      const sga::Sequence &sequence, Workspace &workspace,
+      const QueryLengthType max_cost =
+          std::numeric_limits<QueryLengthType>::max()) const {
+    assert(IsCompressedRepresentationGenerated());
+    QueryLengthType max_penalty = std::max(
         std::max(substitution_penalty_, deletion_penalty_), insertion_penalty_);
-    const GraphSizeType num_vertices = GetNumVertices();
+    const GraphSizeType num_vertices = graph_.num_vertices;
     const QueryLengthType sequence_length = sequence.GetLength();
-    const std::string &sequence_bases = sequence.GetSequence();
-    std::vector<QueryLengthType> previous_layer(num_vertices,
-                                                sequence_length * max_cost + 1);
-    std::vector<QueryLengthType> current_layer(num_vertices, 0);
-
-    GraphSizeType num_propagations = 0;
+    const StringView sequence_bases = sequence.GetSequence();
+    std::vector<QueryLengthType> &previous_layer =
+        workspace.navarro_previous_layer_;
+    std::vector<QueryLengthType> &current_layer =
+        workspace.navarro_current_layer_;
+    previous_layer.assign(num_vertices, sequence_length * max_penalty + 1);
+    current_layer.assign(num_vertices, 0);
 
-    for (QueryLengthType i = 0; i < sequence_length; ++i) {
+    // The layers are skipped once their min is above max_cost, as in
+    // AlignUsingLinearGapPenaltyOnCondensedGraph.
+    QueryLengthType min_cost = 0;
+    for (QueryLengthType i = 0; i < sequence_length && min_cost <= max_cost;
+         ++i) {
       std::swap(previous_layer, current_layer);
-      ComputeLayerWithNavarroAlgorithm(sequence_bases[i], previous_layer,
-                                       num_propagations, current_layer);
+      min_cost = ComputeLayerWithNavarroAlgorithm(
+          sequence_bases[i], previous_layer, current_layer, workspace);
     }
 
-    const QueryLengthType forward_alignment_cost =
-        *std::min_element(current_layer.begin(), current_layer.end());
+    QueryLengthType forward_alignment_cost = 0;
+    QueryLengthType reverse_complement_alignment_cost = 0;
+    if (IsBidirected()) {
+      GetMinCostOnEachStrand(current_layer, forward_alignment_cost,
+                             reverse_complement_alignment_cost);
+    } else {
+      forward_alignment_cost = min_cost;
+
+      // For reverse complement, which only matters if it is below the
+      // forward cost.
+      const QueryLengthType reverse_complement_max_cost =
+          std::min(max_cost, forward_alignment_cost);
+      previous_layer.assign(num_vertices, sequence_length * max_penalty + 1);
+      current_layer.assign(num_vertices, 0);
+
+      min_cost = 0;
+      for (QueryLengthType i = 0;
+           i < sequence_length && min_cost <= reverse_complement_max_cost;
+           ++i) {
+        std::swap(previous_layer, current_layer);
+        min_cost = ComputeLayerWithNavarroAlgorithm(
+            base_complement_[(int)sequence_bases[sequence_length - 1 - i]],
+            previous_layer, current_layer, workspace);
+      }
 
-    // For reverse complement.
-    previous_layer.assign(num_vertices, sequence_length * max_cost + 1);
-    current_layer.assign(num_vertices, 0);
+      reverse_complement_alignment_cost = min_cost;
+    }
+
+    const QueryLengthType min_alignment_cost =
+        std::min(forward_alignment_cost, reverse_complement_alignment_cost);
+    return min_alignment_cost;
+  }
+
+  // Same as above but uses the workspace owned by the graph, thus it is not
+  // thread-safe.
+  QueryLengthType AlignUsingLinearGapPenaltyWithNavarroAlgorithm(
+      const sga::Sequence &sequence,
+      const QueryLengthType max_cost =
+          std::numeric_limits<QueryLengthType>::max()) {
+    return AlignUsingLinearGapPenaltyWithNavarroAlgorithm(
+        sequence, default_workspace_, max_cost);
+  }
+
+  // Relax a cell of the current layer of the active set aligner. Only the
+  // cells with costs up to max_cost are kept, and a cell becomes active the
+  // first time it is set. Return true if the cell is improved.
+  bool RelaxActiveCell(const GraphSizeType vertex, const int distance,
+                       const QueryLengthType max_cost,
+                       std::vector<QueryLengthType> &current_layer,
+                       std::vector<GraphSizeType> &current_active_vertices)
+      const {
+    if (distance > max_cost || distance >= current_layer[vertex]) {
+      return false;
+    }
+    if (current_layer[vertex] == std::numeric_limits<QueryLengthType>::max()) {
+      current_active_vertices.push_back(vertex);
+    }
+    current_layer[vertex] = distance;
+    return true;
+  }
+
+  // Whether the label of the vertex is not the base of the row, from the word
+  // of the packed labels mismatch mask of the row, which is only computed for
+  // the vertices looked up in the row.
+  bool IsMismatchInRow(const char sequence_base, const int32_t row,
+                       const GraphSizeType vertex, Workspace &workspace) const {
+    const size_t wi = vertex >> 6;
+    if (workspace.mismatch_mask_rows_[wi] != row) {
+      workspace.mismatch_mask_rows_[wi] = row;
+      workspace.mismatch_mask_[wi] =
+          packed_labels_.GetMismatchWord(sequence_base, wi);
+    }
+    return PackedLabels::IsMismatch(workspace.mismatch_mask_.data(), vertex);
+  }
+
+  // Compute a layer from the active cells of the previous layer, i.e. the
+  // ones with costs up to max_cost, as in Ukkonen's cut-off. The cells above
+  // max_cost are never set, so a layer costs O(active cells + their edges)
+  // instead of O(V + E), except for the first layers where vertex 0 is still
+  // within max_cost and every vertex can start an alignment. Even then, only
+  // the matches are seeded from vertex 0, read from the zero bits of the
+  // mismatch mask, unless the substitutions are within max_cost too. The
+  // inactive cells of both layers are kept at the max value of
+  // QueryLengthType. Row -1 is 0 for every vertex like vertex 0, so it has no
+  // active cells and its deletions into row 0 are seeded here.
+  void ComputeLayerWithActiveSet(
+      const char sequence_base, const int32_t row,
+      const QueryLengthType previous_source_cost,
+      const QueryLengthType max_cost,
+      std::vector<QueryLengthType> &previous_layer,
+      std::vector<GraphSizeType> &previous_active_vertices,
+      std::vector<QueryLengthType> &current_layer,
+      std::vector<GraphSizeType> &current_active_vertices,
+      Workspace &workspace) const {
+    current_active_vertices.clear();
+    // Matches or substitutions from vertex 0, which precedes every vertex.
+    if (previous_source_cost <= max_cost) {
+      const int mismatch_cost =
+          row == 0 ? std::min(substitution_penalty_, deletion_penalty_)
+                   : substitution_penalty_;
+      const bool is_mismatch_active =
+          previous_source_cost + mismatch_cost <= max_cost;
+      const size_t num_mask_words = packed_labels_.GetNumMaskWords();
+      for (size_t wi = 0; wi < num_mask_words; ++wi) {
+        const uint64_t mismatch_bits =
+            packed_labels_.GetMismatchWord(sequence_base, wi);
+        workspace.mismatch_mask_[wi] = mismatch_bits;
+        workspace.mismatch_mask_rows_[wi] = row;
+        const size_t num_last_bits = graph_.num_vertices - (wi << 6);
+        uint64_t seeds = num_last_bits >= 64
+                             ? ~(uint64_t)0
+                             : ((uint64_t)1 << num_last_bits) - 1;
+        if (!is_mismatch_active) {
+          seeds &= ~mismatch_bits;
+        }
+        if (wi == 0) {
+          seeds &= ~(uint64_t)1;
+        }
+        for (; seeds != 0; seeds &= seeds - 1) {
+          const size_t bit = __builtin_ctzll(seeds);
+          const int cost = (mismatch_bits >> bit) & 1 ? mismatch_cost : 0;
+          RelaxActiveCell((wi << 6) + bit, previous_source_cost + cost,
+                          max_cost, current_layer, current_active_vertices);
+        }
+      }
+    }
+
+    // Deletions, and matches or substitutions along the out-edges.
+    for (const GraphSizeType vertex : previous_active_vertices) {
+      const int distance = previous_layer[vertex];
+      RelaxActiveCell(vertex, distance + deletion_penalty_, max_cost,
+                      current_layer, current_active_vertices);
+      for (const GraphSizeType neighbor : graph_.GetNeighbors(vertex)) {
+        const int cost =
+            IsMismatchInRow(sequence_base, row, neighbor, workspace)
+                ? substitution_penalty_
+                : 0;
+        RelaxActiveCell(neighbor, distance + cost, max_cost, current_layer,
+                        current_active_vertices);
+      }
+      // Deactivate the cell so the layer can be reused for the next one.
+      previous_layer[vertex] = std::numeric_limits<QueryLengthType>::max();
+    }
+
+    // Insertions, settled in increasing order of costs.
+    workspace.propagation_queue_.Clear();
+    for (const GraphSizeType vertex : current_active_vertices) {
+      workspace.propagation_queue_.Push(current_layer[vertex], vertex);
+    }
+    while (!workspace.propagation_queue_.Empty()) {
+      QueryLengthType distance = 0;
+      const GraphSizeType vertex = workspace.propagation_queue_.Pop(distance);
+      // Skip the stale entries of the vertices improved after being pushed.
+      if (current_layer[vertex] != distance) {
+        continue;
+      }
+      for (const GraphSizeType neighbor : graph_.GetNeighbors(vertex)) {
+        if (RelaxActiveCell(neighbor, distance + insertion_penalty_, max_cost,
+                            current_layer, current_active_vertices)) {
+          workspace.propagation_queue_.Push(current_layer[neighbor], neighbor);
+        }
+      }
+    }
+  }
+
+  // Compute the last layer of the query with the active set aligner and
+  // return its min cost, or max_cost + 1 if it is above max_cost. On a
+  // bidirected graph, the min cost on the reverse complementary strand is
+  // returned separately in reverse_complement_cost.
+  QueryLengthType ComputeLastLayerWithActiveSet(
+      const char *sequence_bases, const QueryLengthType sequence_length,
+      const bool is_reverse_complement, const QueryLengthType max_cost,
+      Workspace &workspace, QueryLengthType &reverse_complement_cost) const {
+    const GraphSizeType num_vertices = graph_.num_vertices;
+    std::vector<QueryLengthType> &previous_layer =
+        workspace.navarro_previous_layer_;
+    std::vector<QueryLengthType> &current_layer =
+        workspace.navarro_current_layer_;
+    std::vector<GraphSizeType> &previous_active_vertices =
+        workspace.previous_active_vertices_;
+    std::vector<GraphSizeType> &current_active_vertices =
+        workspace.current_active_vertices_;
+    // Row -1 is left to vertex 0, see ComputeLayerWithActiveSet.
+    previous_layer.assign(num_vertices,
+                          std::numeric_limits<QueryLengthType>::max());
+    current_layer.assign(num_vertices,
+                         std::numeric_limits<QueryLengthType>::max());
+    previous_active_vertices.clear();
+    workspace.mismatch_mask_.resize(packed_labels_.GetNumMaskWords());
+    workspace.mismatch_mask_rows_.assign(packed_labels_.GetNumMaskWords(), -1);
+    // The cost of vertex 0 in the previous layer, which is only deletions.
+    int source_cost = 0;
 
     for (QueryLengthType i = 0; i < sequence_length; ++i) {
+      if (previous_active_vertices.empty() && source_cost > max_cost) {
+        break;
+      }
+      const char sequence_base =
+          is_reverse_complement
+              ? base_complement_[(int)sequence_bases[sequence_length - 1 - i]]
+              : sequence_bases[i];
+      ComputeLayerWithActiveSet(
+          sequence_base, i, std::min(source_cost, max_cost + 1), max_cost,
+          previous_layer, previous_active_vertices, current_layer,
+          current_active_vertices, workspace);
       std::swap(previous_layer, current_layer);
-      ComputeLayerWithNavarroAlgorithm(
-          base_complement_[(int)sequence_bases[sequence_length - 1 - i]],
-          previous_layer, num_propagations, current_layer);
+      std::swap(previous_active_vertices, current_active_vertices);
+      source_cost += deletion_penalty_;
     }
 
-    const QueryLengthType reverse_complement_alignment_cost =
-        *std::min_element(current_layer.begin(), current_layer.end());
+    // The last layer is the previous one after the swap.
+    QueryLengthType min_cost = std::min(source_cost, max_cost + 1);
+    reverse_complement_cost = min_cost;
+    for (const GraphSizeType vertex : previous_active_vertices) {
+      QueryLengthType &cost = IsReverseComplementaryVertex(vertex)
+                                  ? reverse_complement_cost
+                                  : min_cost;
+      cost = std::min(cost, previous_layer[vertex]);
+    }
+    return min_cost;
+  }
+
+  // Align the sequence and its reverse complement with the cells of cost up
+  // to max_cost only, see ComputeLayerWithActiveSet. The costs up to max_cost
+  // are the same as the ones of AlignUsingLinearGapPenaltyWithNavarroAlgorithm
+  // and max_cost + 1 is returned for the ones above. The forward cost bounds
+  // the reverse complement one.
+  QueryLengthType AlignUsingLinearGapPenaltyWithActiveSet(
+      const sga::Sequence &sequence, Workspace &workspace,
+      const QueryLengthType max_cost) const {
+    assert(IsCompressedRepresentationGenerated());
+    assert(max_cost < std::numeric_limits<QueryLengthType>::max() -
+                          std::max(std::max(substitution_penalty_,
+                                            deletion_penalty_),
+                                   insertion_penalty_));
+    const QueryLengthType sequence_length = sequence.GetLength();
+    const char *sequence_bases = sequence.GetSequence().data();
+
+    QueryLengthType reverse_complement_alignment_cost = 0;
+    const QueryLengthType forward_alignment_cost =
+        ComputeLastLayerWithActiveSet(sequence_bases, sequence_length,
+                                      /*is_reverse_complement=*/false,
+                                      max_cost, workspace,
+                                      reverse_complement_alignment_cost);
+    if (!IsBidirected()) {
+      QueryLengthType unused_cost = 0;
+      reverse_complement_alignment_cost = ComputeLastLayerWithActiveSet(
+          sequence_bases, sequence_length, /*is_reverse_complement=*/true,
+          std::min(max_cost, forward_alignment_cost), workspace, unused_cost);
+    }
 
     const QueryLengthType min_alignment_cost =
         std::min(forward_alignment_cost, reverse_complement_alignment_cost);
-
-    std::cerr << "Sequence length: " << sequence_length
-              << ", forward alignment cost:" << forward_alignment_cost
-              << ", reverse complement alignment cost:"
-              << reverse_complement_alignment_cost
-              << ", alignment cost:" << min_alignment_cost
-              << ", num propogations: " << num_propagations << std::endl;
     return min_alignment_cost;
   }
 
+  // Same as above but uses the workspace owned by the graph, thus it is not
+  // thread-safe.
+  QueryLengthType AlignUsingLinearGapPenaltyWithActiveSet(
+      const sga::Sequence &sequence, const QueryLengthType max_cost) {
+    return AlignUsingLinearGapPenaltyWithActiveSet(sequence, default_workspace_,
+                                                   max_cost);
+  }
+
+  // The start vertex is given by its original id. max_cost bounds the cost as
+  // in AlignUsingLinearGapPenalty.
   QueryLengthType ForwardExtendUsingLinearGapPenaltyWithNavarroAlgorithm(
-      const sga::Sequence &sequence, GraphSizeType start_vertex) {
-    QueryLengthType max_cost = std::max(
+      const sga::Sequence &sequence, GraphSizeType start_vertex,
+      Workspace &workspace,
+      const QueryLengthType max_cost =
+          std::numeric_limits<QueryLengthType>::max()) const {
+    assert(IsCompressedRepresentationGenerated());
+    start_vertex = GetVertexId(start_vertex);
+    QueryLengthType max_penalty = std::max(
         std::max(substitution_penalty_, deletion_penalty_), insertion_penalty_);
-    const GraphSizeType num_vertices = GetNumVertices();
+    const GraphSizeType num_vertices = graph_.num_vertices;
     const QueryLengthType sequence_length = sequence.GetLength();
-    const std::string &sequence_bases = sequence.GetSequence();
-    std::vector<QueryLengthType> previous_layer(num_vertices,
-                                                sequence_length * max_cost + 1);
-    std::vector<QueryLengthType> current_layer(num_vertices,
-                                               sequence_length * max_cost + 1);
+    const StringView sequence_bases = sequence.GetSequence();
+    std::vector<QueryLengthType> &previous_layer =
+        workspace.navarro_previous_layer_;
+    std::vector<QueryLengthType> &current_layer =
+        workspace.navarro_current_layer_;
+    previous_layer.assign(num_vertices, sequence_length * max_penalty + 1);
+    current_layer.assign(num_vertices, sequence_length * max_penalty + 1);
     current_layer[0] = deletion_penalty_;
     current_layer[start_vertex] =
-        sequence_bases[0] == labels_[start_vertex] ? 0 : substitution_penalty_;
+        sequence_bases[0] == graph_.labels[start_vertex]
+            ? 0
+            : substitution_penalty_;
+
+    // The other cells of the first layer are above any alignment cost.
+    QueryLengthType min_cost =
+        std::min(current_layer[0], current_layer[start_vertex]);
+    for (QueryLengthType i = 1; i < sequence_length && min_cost <= max_cost;
+         ++i) {
+      std::swap(previous_layer, current_layer);
+      min_cost = ComputeLayerWithNavarroAlgorithm(
+          sequence_bases[i], previous_layer, current_layer, workspace);
+    }
+    return min_cost;
+  }
 
-    GraphSizeType num_propagations = 0;
+  // Same as above but uses the workspace owned by the graph, thus it is not
+  // thread-safe.
+  QueryLengthType ForwardExtendUsingLinearGapPenaltyWithNavarroAlgorithm(
+      const sga::Sequence &sequence, GraphSizeType start_vertex,
+      const QueryLengthType max_cost =
+          std::numeric_limits<QueryLengthType>::max()) {
+    return ForwardExtendUsingLinearGapPenaltyWithNavarroAlgorithm(
+        sequence, start_vertex, default_workspace_, max_cost);
+  }
 
-    for (QueryLengthType i = 1; i < sequence_length; ++i) {
-      std::swap(previous_layer, current_layer);
-      ComputeLayerWithNavarroAlgorithm(sequence_bases[i], previous_layer,
-                                       num_propagations, current_layer);
+  // One step of Myers' bit-parallel algorithm on a block of 64 rows, in the
+  // form of Hyyro with the horizontal delta hin at the top of the block. It
+  // computes the vertical deltas of a column from the ones of its previous
+  // column and returns the horizontal delta at the bottom of the block.
+  static int ComputeMyersBlock(const uint64_t previous_positive_deltas,
+                               const uint64_t previous_negative_deltas,
+                               uint64_t match_mask, const int hin,
+                               uint64_t &positive_deltas,
+                               uint64_t &negative_deltas) {
+    const uint64_t is_hin_negative = hin < 0 ? 1 : 0;
+    const uint64_t xv = match_mask | previous_negative_deltas;
+    match_mask |= is_hin_negative;
+    const uint64_t xh = (((match_mask & previous_positive_deltas) +
+                          previous_positive_deltas) ^
+                         previous_positive_deltas) |
+                        match_mask;
+    uint64_t horizontal_positive_deltas =
+        previous_negative_deltas | ~(xh | previous_positive_deltas);
+    uint64_t horizontal_negative_deltas = previous_positive_deltas & xh;
+    const int hout = (int)(horizontal_positive_deltas >> 63) -
+                     (int)(horizontal_negative_deltas >> 63);
+    horizontal_positive_deltas <<= 1;
+    horizontal_negative_deltas <<= 1;
+    horizontal_negative_deltas |= is_hin_negative;
+    horizontal_positive_deltas |= hin > 0 ? 1 : 0;
+    positive_deltas =
+        horizontal_negative_deltas | ~(xv | horizontal_positive_deltas);
+    negative_deltas = horizontal_positive_deltas & xv;
+    return hout;
+  }
+
+  // Compute the column of a vertex with the given label from the column of
+  // one of its in-neighbors. A column is stored as the positive and negative
+  // vertical delta masks of each block. A null previous column stands for the
+  // column of vertex 0, whose distances increase by one every row.
+  static void ComputeMyersColumn(const uint64_t *previous_column,
+                                 const char label, const size_t num_blocks,
+                                 const uint64_t *match_masks,
+                                 uint64_t *column) {
+    const uint64_t *label_match_masks =
+        match_masks + (uint8_t)label * num_blocks;
+    // All the distances in row -1 are 0, thus the horizontal delta is 0 at the
+    // top.
+    int hin = 0;
+    for (size_t bi = 0; bi < num_blocks; ++bi) {
+      const uint64_t previous_positive_deltas =
+          previous_column == nullptr ? ~(uint64_t)0
+                                     : previous_column[bi << 1];
+      const uint64_t previous_negative_deltas =
+          previous_column == nullptr ? 0 : previous_column[(bi << 1) + 1];
+      hin = ComputeMyersBlock(previous_positive_deltas,
+                              previous_negative_deltas, label_match_masks[bi],
+                              hin, column[bi << 1], column[(bi << 1) + 1]);
     }
+  }
 
-    const QueryLengthType forward_alignment_cost =
-        *std::min_element(current_layer.begin(), current_layer.end());
+  // The number of set bits in each byte of x, in the byte.
+  static uint64_t CountBitsInBytes(uint64_t x) {
+    x = x - ((x >> 1) & 0x5555555555555555);
+    x = (x & 0x3333333333333333) + ((x >> 2) & 0x3333333333333333);
+    return (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0f;
+  }
 
-    std::cerr << "Sequence length: " << sequence_length
-              << ", forward alignment cost:" << forward_alignment_cost
-              << ", num propogations: " << num_propagations << std::endl;
-    return forward_alignment_cost;
+  // Set column to the row-wise min of itself and the candidate column, a
+  // block of 64 rows at a time. The difference of the distances of column
+  // minus the ones of the candidate column is carried from block to block
+  // with the popcounts of the deltas. A block where this difference cannot
+  // change sign is copied from the lower column. Otherwise the difference is
+  // tracked for 8 groups of 8 rows at once, one per byte of a word, and the
+  // min takes the deltas of the lower column, or 0 where the columns cross.
+  // Return true if column is changed.
+  static bool MergeMyersColumns(const uint64_t *candidate_column,
+                                const size_t num_blocks, uint64_t *column) {
+    if (std::equal(candidate_column, candidate_column + (num_blocks << 1),
+                   column)) {
+      return false;
+    }
+    const uint64_t low_bits = 0x0101010101010101;
+    bool is_changed = false;
+    // The difference in the row before the block, where both distances are 0
+    // for the first block.
+    int difference = 0;
+    for (size_t bi = 0; bi < (num_blocks << 1); bi += 2) {
+      const uint64_t candidate_positive_deltas = candidate_column[bi];
+      const uint64_t candidate_negative_deltas = candidate_column[bi + 1];
+      const uint64_t positive_deltas = column[bi];
+      const uint64_t negative_deltas = column[bi + 1];
+      // The increases and decreases of the difference in each group, which
+      // are at most 16 each, and over the block.
+      const uint64_t group_increases =
+          CountBitsInBytes(positive_deltas) +
+          CountBitsInBytes(candidate_negative_deltas);
+      const uint64_t group_decreases =
+          CountBitsInBytes(negative_deltas) +
+          CountBitsInBytes(candidate_positive_deltas);
+      const int increase = (int)((group_increases * low_bits) >> 56);
+      const int decrease = (int)((group_decreases * low_bits) >> 56);
+
+      uint64_t min_positive_deltas = positive_deltas;
+      uint64_t min_negative_deltas = negative_deltas;
+      if (difference - decrease >= 0) {
+        // The candidate column is not above column in any row.
+        min_positive_deltas = candidate_positive_deltas;
+        min_negative_deltas = candidate_negative_deltas;
+      } else if (difference + increase > 0) {
+        // The difference at the start of each group, clamped to [-17, 17] as
+        // it changes by at most 16 in a group, plus 64. So each byte stays in
+        // [31, 97] and is at least 64 where the difference is at least 0.
+        uint64_t group_differences = 0;
+        int group_difference = difference;
+        for (int gi = 0; gi < 8; ++gi) {
+          const int clamped_difference =
+              std::min(std::max(group_difference, -17), 17);
+          group_differences |= (uint64_t)(clamped_difference + 64)
+                               << (gi << 3);
+          group_difference += (int)((group_increases >> (gi << 3)) & 0xff) -
+                              (int)((group_decreases >> (gi << 3)) & 0xff);
+        }
+        // The rows where the difference is at least 0, and at most 0.
+        uint64_t is_candidate_min = 0;
+        uint64_t is_column_min = 0;
+        for (int i = 0; i < 8; ++i) {
+          group_differences += ((positive_deltas >> i) & low_bits) +
+                               ((candidate_negative_deltas >> i) & low_bits);
+          group_differences -= ((negative_deltas >> i) & low_bits) +
+                               ((candidate_positive_deltas >> i) & low_bits);
+          is_candidate_min |= ((group_differences >> 6) & low_bits) << i;
+          is_column_min |=
+              (~((group_differences + 63 * low_bits) >> 7) & low_bits) << i;
+        }
+        // A row takes the delta of a column that is the min in the row and
+        // the row before. The columns only cross between differences of 1 and
+        // -1, where the min does not change.
+        const uint64_t is_candidate_delta =
+            is_candidate_min &
+            ((is_candidate_min << 1) | (difference >= 0 ? 1 : 0));
+        const uint64_t is_column_delta =
+            is_column_min & ((is_column_min << 1) | (difference <= 0 ? 1 : 0));
+        min_positive_deltas = (candidate_positive_deltas & is_candidate_delta) |
+                              (positive_deltas & is_column_delta);
+        min_negative_deltas = (candidate_negative_deltas & is_candidate_delta) |
+                              (negative_deltas & is_column_delta);
+      }
+      difference += increase - decrease;
+      is_changed = is_changed || min_positive_deltas != positive_deltas ||
+                   min_negative_deltas != negative_deltas;
+      column[bi] = min_positive_deltas;
+      column[bi + 1] = min_negative_deltas;
+    }
+    return is_changed;
   }
 
-  ScoreType AlignUsingLinearGapPenaltyWithDijkstraAlgorithm(
-      const sga::Sequence &sequence, GraphSizeType start_vertex,
-      DijkstraAlgorithmStatistics<GraphSizeType> &stats) {
-    const GraphSizeType num_vertices = GetNumVertices();
+  // Compute the distances in the last row for the given query with Myers'
+  // bit-parallel algorithm extended to graphs. Each vertex has a column of
+  // vertical deltas, 64 rows per word. The columns are pushed to the
+  // out-neighbors in topological order and merged by row-wise min at vertices
+  // with several in-neighbors. On cyclic graphs, the vertices whose column
+  // changes after they are visited are revisited with a FIFO worklist until no
+  // column changes. On a bidirected graph, the min distance on the reverse
+  // complementary strand is returned separately in
+  // reverse_complement_min_distance.
+  QueryLengthType ComputeLastRowWithMyersAlgorithm(
+      const std::string &query, Workspace &workspace,
+      QueryLengthType &reverse_complement_min_distance) const {
+    const GraphSizeType num_vertices = graph_.num_vertices;
+    const size_t query_length = query.length();
+    const size_t num_blocks = (query_length + 63) / 64;
+    const size_t column_size = num_blocks << 1;
+
+    std::vector<uint64_t> &match_masks = workspace.myers_match_masks_;
+    match_masks.assign(256 * num_blocks, 0);
+    for (size_t i = 0; i < query_length; ++i) {
+      match_masks[(uint8_t)query[i] * num_blocks + (i >> 6)] |= (uint64_t)1
+                                                                << (i & 63);
+    }
+
+    std::vector<uint64_t> &columns = workspace.myers_columns_;
+    columns.resize(num_vertices * column_size);
+    // 0 if the column is not set, 1 if it is set and 2 if the vertex is
+    // visited.
+    std::vector<uint8_t> &column_states = workspace.myers_column_states_;
+    column_states.assign(num_vertices, 0);
+    std::vector<GraphSizeType> &worklist = workspace.myers_worklist_;
+    worklist.clear();
+    std::vector<uint8_t> &is_in_worklist = workspace.myers_is_in_worklist_;
+    std::vector<uint64_t> &candidate_column = workspace.myers_candidate_column_;
+    candidate_column.resize(column_size);
+
+    // Push the column of the vertex to its out-neighbors.
+    auto push_column = [&](const GraphSizeType vertex) {
+      const uint64_t *column = columns.data() + vertex * column_size;
+      for (const GraphSizeType neighbor : graph_.GetNeighbors(vertex)) {
+        uint64_t *neighbor_column = columns.data() + neighbor * column_size;
+        bool is_changed = true;
+        if (column_states[neighbor] == 0) {
+          ComputeMyersColumn(column, graph_.labels[neighbor], num_blocks,
+                             match_masks.data(), neighbor_column);
+          column_states[neighbor] = 1;
+        } else {
+          ComputeMyersColumn(column, graph_.labels[neighbor], num_blocks,
+                             match_masks.data(), candidate_column.data());
+          is_changed = MergeMyersColumns(candidate_column.data(), num_blocks,
+                                         neighbor_column);
+        }
+        if (is_changed && column_states[neighbor] == 2 &&
+            !is_in_worklist[neighbor]) {
+          is_in_worklist[neighbor] = 1;
+          worklist.push_back(neighbor);
+        }
+      }
+    };
+
+    if (!is_acyclic_) {
+      is_in_worklist.assign(num_vertices, 0);
+    }
+    // The vertices are numbered in topological order of their components.
+    for (GraphSizeType vertex = 1; vertex < num_vertices; ++vertex) {
+      if (column_states[vertex] == 0) {
+        // No in-neighbor has been visited, so start from vertex 0, which
+        // precedes every vertex.
+        ComputeMyersColumn(nullptr, graph_.labels[vertex], num_blocks,
+                           match_masks.data(),
+                           columns.data() + vertex * column_size);
+      }
+      column_states[vertex] = 2;
+      push_column(vertex);
+    }
+
+    for (size_t i = 0; i < worklist.size(); ++i) {
+      const GraphSizeType vertex = worklist[i];
+      is_in_worklist[vertex] = 0;
+      push_column(vertex);
+    }
+
+    // The distance of vertex 0 in the last row is the query length.
+    QueryLengthType min_distance = query_length;
+    reverse_complement_min_distance = query_length;
+    const uint64_t last_block_mask =
+        (query_length & 63) == 0 ? ~(uint64_t)0
+                                 : ((uint64_t)1 << (query_length & 63)) - 1;
+    for (GraphSizeType vertex = 1; vertex < num_vertices; ++vertex) {
+      const uint64_t *column = columns.data() + vertex * column_size;
+      int distance = 0;
+      for (size_t bi = 0; bi + 1 < num_blocks; ++bi) {
+        distance += __builtin_popcountll(column[bi << 1]) -
+                    __builtin_popcountll(column[(bi << 1) + 1]);
+      }
+      distance += __builtin_popcountll(column[column_size - 2] &
+                                       last_block_mask) -
+                  __builtin_popcountll(column[column_size - 1] &
+                                       last_block_mask);
+      QueryLengthType &strand_min_distance =
+          IsReverseComplementaryVertex(vertex) ? reverse_complement_min_distance
+                                               : min_distance;
+      if (distance < strand_min_distance) {
+        strand_min_distance = distance;
+      }
+    }
+    return min_distance;
+  }
+
+  // Align the sequence and its reverse complement with unit costs using
+  // Myers' bit-parallel algorithm. It gives the same costs as
+  // AlignUsingLinearGapPenaltyWithNavarroAlgorithm, which is used instead when
+  // the penalties are not all 1. The columns span the whole query, so no
+  // layer is ever complete before the end and max_cost is only passed on to
+  // that fallback.
+  QueryLengthType AlignUsingLinearGapPenaltyWithMyersAlgorithm(
+      const sga::Sequence &sequence, Workspace &workspace,
+      const QueryLengthType max_cost =
+          std::numeric_limits<QueryLengthType>::max()) const {
+    assert(IsCompressedRepresentationGenerated());
+    if (substitution_penalty_ != 1 || deletion_penalty_ != 1 ||
+        insertion_penalty_ != 1) {
+      return AlignUsingLinearGapPenaltyWithNavarroAlgorithm(
+          sequence, workspace, max_cost);
+    }
     const QueryLengthType sequence_length = sequence.GetLength();
-    const std::string &sequence_bases = sequence.GetSequence();
-
-    std::vector<std::unordered_map<QueryLengthType, ScoreType>>
-        forward_vertex_distances(num_vertices);
-    std::vector<std::unordered_map<QueryLengthType, ScoreType>>
-        complementary_vertex_distances(num_vertices);
-
-    // std::vector<khash_t(k32) *> forward_vertex_distances(num_vertices,
-    // nullptr); std::vector<khash_t(k32) *>
-    // complementary_vertex_distances(num_vertices,
-    //                                                           nullptr);
-    // for (GraphSizeType vi = 0; vi < num_vertices; ++vi) {
-    //  forward_vertex_distances[vi] = kh_init(k32);
-    //  complementary_vertex_distances[vi] = kh_init(k32);
-    //}
+    const StringView sequence_bases = sequence.GetSequence();
+
+    std::string &query = workspace.myers_query_;
+    query.assign(sequence_bases.begin(), sequence_bases.end());
+    QueryLengthType reverse_complement_alignment_cost = 0;
+    const QueryLengthType forward_alignment_cost =
+        ComputeLastRowWithMyersAlgorithm(query, workspace,
+                                         reverse_complement_alignment_cost);
+
+    if (!IsBidirected()) {
+      // For reverse complement.
+      for (QueryLengthType i = 0; i < sequence_length; ++i) {
+        query[i] =
+            base_complement_[(int)sequence_bases[sequence_length - 1 - i]];
+      }
+      QueryLengthType unused_cost = 0;
+      reverse_complement_alignment_cost =
+          ComputeLastRowWithMyersAlgorithm(query, workspace, unused_cost);
+    }
+
+    const QueryLengthType min_alignment_cost =
+        std::min(forward_alignment_cost, reverse_complement_alignment_cost);
+    return min_alignment_cost;
+  }
+
+  // Same as above but uses the workspace owned by the graph, thus it is not
+  // thread-safe.
+  QueryLengthType AlignUsingLinearGapPenaltyWithMyersAlgorithm(
+      const sga::Sequence &sequence,
+      const QueryLengthType max_cost =
+          std::numeric_limits<QueryLengthType>::max()) {
+    return AlignUsingLinearGapPenaltyWithMyersAlgorithm(
+        sequence, default_workspace_, max_cost);
+  }
+
+  // The compacted graph is read from its CSR format and the chains of the
+  // char labeled graph once the compressed representation is generated or
+  // loaded from an index, which does not keep the compacted graph labels, and
+  // from the adjacency list and the labels before.
+  GraphSizeType GetNumCompactedGraphVertices() const {
+    return IsCompressedRepresentationGenerated()
+               ? compacted_graph_.num_vertices
+               : (GraphSizeType)compacted_graph_labels_.size();
+  }
+
+  typename CompressedSparseRowGraph<GraphSizeType>::NeighborRange
+  GetCompactedGraphNeighbors(const GraphSizeType vertex) const {
+    if (IsCompressedRepresentationGenerated()) {
+      return compacted_graph_.GetNeighbors(vertex);
+    }
+    const std::vector<GraphSizeType> &neighbors =
+        compacted_graph_adjacency_list_[vertex];
+    return {neighbors.data(), neighbors.data() + neighbors.size()};
+  }
+
+  // The label of a compacted vertex, which is either kept or spelled from its
+  // chain into the given buffer.
+  const std::string &GetCompactedGraphLabel(const GraphSizeType vertex,
+                                            std::string &label) const {
+    if (!compacted_graph_labels_.empty()) {
+      return compacted_graph_labels_[vertex];
+    }
+    label.assign(1, graph_.labels[GetVertexId(vertex)]);
+    for (GraphSizeType original_vertex = chain_offsets_view_[vertex];
+         original_vertex < chain_offsets_view_[vertex + 1];
+         ++original_vertex) {
+      label.push_back(graph_.labels[GetVertexId(original_vertex)]);
+    }
+    return label;
+  }
 
-    // std::vector<std::unordered_map<
-    //    QueryLengthType, VertexWithDistanceForDijkstra<
-    //                         GraphSizeType, QueryLengthType, ScoreType>>>
-    //    vertex_parent(num_vertices);
-
-    auto compare_function =
-        [](const VertexWithDistanceForDijkstra<GraphSizeType, QueryLengthType,
-                                               ScoreType> &v1,
-           const VertexWithDistanceForDijkstra<GraphSizeType, QueryLengthType,
-                                               ScoreType> &v2) {
-          if (v1.distance > v2.distance) {
-            return true;
+  // Order the vertices of the compacted graph in reverse postorder of a
+  // depth-first search, which is a topological order if it is acyclic.
+  void OrderCompactedGraphVertices(Workspace &workspace) const {
+    const GraphSizeType num_vertices = GetNumCompactedGraphVertices();
+    std::vector<GraphSizeType> &order = workspace.compacted_graph_order_;
+    order.clear();
+    std::vector<uint8_t> &is_visited = workspace.compacted_graph_is_queued_;
+    is_visited.assign(num_vertices, 0);
+    // The vertices being explored and the indices of their next out-edges.
+    std::vector<std::pair<GraphSizeType, size_t>> call_stack;
+    for (GraphSizeType root = 0; root < num_vertices; ++root) {
+      if (is_visited[root]) {
+        continue;
+      }
+      is_visited[root] = 1;
+      call_stack.emplace_back(root, 0);
+      while (!call_stack.empty()) {
+        const GraphSizeType vertex = call_stack.back().first;
+        size_t &edge_index = call_stack.back().second;
+        const typename CompressedSparseRowGraph<GraphSizeType>::NeighborRange
+            neighbors = GetCompactedGraphNeighbors(vertex);
+        if (edge_index < (size_t)(neighbors.end() - neighbors.begin())) {
+          const GraphSizeType neighbor = neighbors.begin()[edge_index];
+          ++edge_index;
+          if (!is_visited[neighbor]) {
+            is_visited[neighbor] = 1;
+            call_stack.emplace_back(neighbor, 0);
           }
+        } else {
+          order.push_back(vertex);
+          call_stack.pop_back();
+        }
+      }
+    }
+    std::reverse(order.begin(), order.end());
+  }
 
-          if (v1.distance == v2.distance) {
-            if (v1.query_index < v2.query_index) {
-              return true;
-            }
-            if (v1.query_index == v2.query_index) {
-              if (v1.graph_vertex_id > v2.graph_vertex_id) {
-                return true;
-              }
-              if (v1.graph_vertex_id == v2.graph_vertex_id) {
-                if (!v1.is_reverse_complementary &&
-                    v2.is_reverse_complementary) {
-                  return true;
-                }
-                return false;
-              }
-              return false;
-            }
-            return false;
+  // Compute the min cost of the last row of the DP on the compacted graph. The
+  // cells of a compacted vertex are computed one column per char, i.e. one
+  // value per query position, as in sequence to sequence alignment. Only the
+  // column of the last char is pushed to the entry columns of the
+  // out-neighbors, which is where the graph joins are resolved. The compacted
+  // vertices are visited in topological order when the graph is acyclic,
+  // otherwise the ones whose entry column is improved are visited again until
+  // no column changes. Only the cells with costs up to max_cost are exact, as
+  // in Ukkonen's cut-off: a column is computed down to the row after its last
+  // active row, i.e. the last row with a cost up to max_cost, and the rows
+  // after it are left out. If the cost is above max_cost, any cost above
+  // max_cost is returned.
+  ScoreType ComputeLastRowOnCompactedGraph(const std::string &query,
+                                           const ScoreType max_cost,
+                                           Workspace &workspace) const {
+    const GraphSizeType num_vertices = GetNumCompactedGraphVertices();
+    const size_t query_length = query.length();
+    // Index 0 of a column is row -1 and index i + 1 is row i.
+    const size_t column_size = query_length + 1;
+    // Large enough to never be a cost, small enough to never overflow.
+    const ScoreType unreachable = std::numeric_limits<ScoreType>::max() / 2;
+    const ScoreType cut_off = std::min(max_cost, (ScoreType)(unreachable - 1));
+
+    // The cost of starting at any vertex from vertex 0 in each row, which is
+    // the same as vertex 0 preceding every vertex in the char labeled graph.
+    // It only increases, so the active rows of the source are a prefix.
+    std::vector<ScoreType> &source_column =
+        workspace.compacted_graph_source_column_;
+    source_column.resize(query_length);
+    size_t num_source_active_rows = 0;
+    for (size_t i = 0; i < query_length; ++i) {
+      source_column[i] = i * deletion_penalty_;
+      if (source_column[i] <= cut_off) {
+        num_source_active_rows = i + 1;
+      }
+    }
+
+    std::vector<ScoreType> &entry_columns =
+        workspace.compacted_graph_entry_columns_;
+    entry_columns.assign(num_vertices * column_size, unreachable);
+    for (GraphSizeType vertex = 0; vertex < num_vertices; ++vertex) {
+      entry_columns[vertex * column_size] = 0;
+    }
+    // The rows of an entry column from this number on are inactive.
+    std::vector<size_t> &entry_num_active_rows =
+        workspace.compacted_graph_entry_num_active_rows_;
+    entry_num_active_rows.assign(num_vertices, 0);
+    std::vector<ScoreType> &previous_column =
+        workspace.compacted_graph_previous_column_;
+    std::vector<ScoreType> &current_column =
+        workspace.compacted_graph_current_column_;
+    previous_column.resize(column_size);
+    current_column.resize(column_size);
+
+    OrderCompactedGraphVertices(workspace);
+    std::vector<GraphSizeType> &worklist = workspace.compacted_graph_order_;
+    std::vector<uint8_t> &is_in_worklist = workspace.compacted_graph_is_queued_;
+    is_in_worklist.assign(num_vertices, 1);
+
+    // Vertex 0 is virtual and its cost in the last row is only deletions.
+    ScoreType min_cost = query_length * deletion_penalty_;
+    for (size_t wi = 0; wi < worklist.size(); ++wi) {
+      const GraphSizeType vertex = worklist[wi];
+      is_in_worklist[vertex] = 0;
+      if (vertex == 0) {
+        continue;
+      }
+      const ScoreType *column = entry_columns.data() + vertex * column_size;
+      size_t num_active_rows = entry_num_active_rows[vertex];
+      for (const char label : GetCompactedGraphLabel(
+               vertex, workspace.compacted_graph_label_)) {
+        // A row after the last active row of the previous column and after
+        // the active rows of the source can only be active through deletions.
+        // The previous column is computed at least down to this row.
+        const size_t num_rows = std::min(
+            query_length, std::max(num_source_active_rows, num_active_rows + 1));
+        // Matches or substitutions from the previous column and insertions,
+        // which are independent across the query positions.
+        current_column[0] = 0;
+        for (size_t i = 0; i < num_rows; ++i) {
+          ScoreType distance = column[i] < source_column[i] ? column[i]
+                                                            : source_column[i];
+          distance += query[i] == label ? 0 : substitution_penalty_;
+          const ScoreType insertion_distance =
+              column[i + 1] + insertion_penalty_;
+          current_column[i + 1] =
+              distance < insertion_distance ? distance : insertion_distance;
+        }
+        // Deletions along the column.
+        num_active_rows = 0;
+        for (size_t i = 0; i < num_rows; ++i) {
+          if (current_column[i + 1] > current_column[i] + deletion_penalty_) {
+            current_column[i + 1] = current_column[i] + deletion_penalty_;
+          }
+          if (current_column[i + 1] <= cut_off) {
+            num_active_rows = i + 1;
           }
-          return false;
-        };
+        }
+        // The deletions past the rows above, down to the first inactive row.
+        size_t num_computed_rows = num_rows;
+        while (num_computed_rows < query_length) {
+          current_column[num_computed_rows + 1] =
+              current_column[num_computed_rows] + deletion_penalty_;
+          ++num_computed_rows;
+          if (current_column[num_computed_rows] > cut_off) {
+            break;
+          }
+          num_active_rows = num_computed_rows;
+        }
+        if (num_computed_rows == query_length &&
+            current_column[query_length] < min_cost) {
+          min_cost = current_column[query_length];
+        }
+        std::swap(previous_column, current_column);
+        column = previous_column.data();
+      }
+
+      for (const GraphSizeType neighbor : GetCompactedGraphNeighbors(vertex)) {
+        ScoreType *entry_column = entry_columns.data() + neighbor * column_size;
+        bool is_changed = false;
+        for (size_t i = 1; i <= num_active_rows; ++i) {
+          is_changed |= column[i] < entry_column[i];
+          entry_column[i] =
+              column[i] < entry_column[i] ? column[i] : entry_column[i];
+        }
+        entry_num_active_rows[neighbor] =
+            std::max(entry_num_active_rows[neighbor], num_active_rows);
+        if (is_changed && !is_in_worklist[neighbor]) {
+          is_in_worklist[neighbor] = 1;
+          worklist.push_back(neighbor);
+        }
+      }
+    }
+    return min_cost;
+  }
 
-    std::priority_queue<VertexWithDistanceForDijkstra<
-                            GraphSizeType, QueryLengthType, ScoreType>,
-                        std::vector<VertexWithDistanceForDijkstra<
-                            GraphSizeType, QueryLengthType, ScoreType>>,
-                        decltype(compare_function)>
-        Q(compare_function);
+  // Align the sequence and its reverse complement directly on the compacted
+  // graph, without generating the char labeled graph. It also works on a
+  // graph loaded from an index, see GetCompactedGraphLabel. It gives the same
+  // costs as AlignUsingLinearGapPenalty, and max_cost bounds the cost in the
+  // same way, see ComputeLastRowOnCompactedGraph. The compacted graph only
+  // has the forward strand even if the char labeled graph is bidirected, so
+  // the reverse complement of the sequence is always aligned in a second
+  // pass, which gives the same cost as the reverse complementary strand.
+  ScoreType AlignUsingLinearGapPenaltyOnCompactedGraph(
+      const sga::Sequence &sequence, Workspace &workspace,
+      const ScoreType max_cost = std::numeric_limits<ScoreType>::max()) const {
+    assert(GetNumCompactedGraphVertices() > 0);
+    const QueryLengthType sequence_length = sequence.GetLength();
+    const StringView sequence_bases = sequence.GetSequence();
+
+    std::string &query = workspace.compacted_graph_query_;
+    query.assign(sequence_bases.begin(), sequence_bases.end());
+    const ScoreType forward_alignment_cost =
+        ComputeLastRowOnCompactedGraph(query, max_cost, workspace);
+
+    // For reverse complement, which only matters if it is below the forward
+    // cost.
+    for (QueryLengthType i = 0; i < sequence_length; ++i) {
+      query[i] = base_complement_[(int)sequence_bases[sequence_length - 1 - i]];
+    }
+    const ScoreType reverse_complement_alignment_cost =
+        ComputeLastRowOnCompactedGraph(
+            query, std::min(max_cost, forward_alignment_cost), workspace);
+
+    const ScoreType min_alignment_cost =
+        std::min(forward_alignment_cost, reverse_complement_alignment_cost);
+    return min_alignment_cost;
+  }
+
+  // Same as above but uses the workspace owned by the graph, thus it is not
+  // thread-safe.
+  ScoreType AlignUsingLinearGapPenaltyOnCompactedGraph(
+      const sga::Sequence &sequence,
+      const ScoreType max_cost = std::numeric_limits<ScoreType>::max()) {
+    return AlignUsingLinearGapPenaltyOnCompactedGraph(
+        sequence, default_workspace_, max_cost);
+  }
+
+  // Pack a cell of the Dijkstra aligner into a key of the distance table.
+  static uint64_t GetDijkstraCellKey(const GraphSizeType vertex,
+                                     const QueryLengthType query_index,
+                                     const bool is_reverse_complementary) {
+    return (((uint64_t)vertex << 1 | is_reverse_complementary) << 32) |
+           (uint32_t)query_index;
+  }
+
+  // Relax the distance of a cell and push it into the queue if it is improved
+  // or visited for the first time. Return true if the cell is pushed.
+  bool RelaxCellForDijkstra(const GraphSizeType vertex,
+                            const QueryLengthType query_index,
+                            const ScoreType distance,
+                            const bool is_reverse_complementary,
+                            DijkstraAlgorithmStatistics<GraphSizeType> &stats,
+                            Workspace &workspace) const {
+    bool is_inserted = false;
+    ScoreType &vertex_distance = workspace.dijkstra_distances_.FindOrInsert(
+        GetDijkstraCellKey(vertex, query_index, is_reverse_complementary),
+        is_inserted);
+    if (!is_inserted && distance >= vertex_distance) {
+      return false;
+    }
+
+    vertex_distance = distance;
+    workspace.dijkstra_queue_.Push(
+        distance, query_index,
+        {/*graph_vertex_id=*/vertex, /*query_index=*/query_index,
+         /*distance=*/distance, /*is_reverse_complementary=*/
+         is_reverse_complementary});
+    if (is_reverse_complementary) {
+      ++(stats.rc_num_cells);
+    } else {
+      ++(stats.forward_num_cells);
+    }
+    return true;
+  }
+
+  ScoreType AlignUsingLinearGapPenaltyWithDijkstraAlgorithm(
+      const sga::Sequence &sequence, GraphSizeType start_vertex,
+      DijkstraAlgorithmStatistics<GraphSizeType> &stats, Workspace &workspace,
+      const ScoreType max_cost) const {
+    assert(IsCompressedRepresentationGenerated());
+    const GraphSizeType num_vertices = graph_.num_vertices;
+    const QueryLengthType sequence_length = sequence.GetLength();
+    const StringView sequence_bases = sequence.GetSequence();
+
+    // The distances of the visited cells of both strands are kept in one flat
+    // hash table, which is reused across alignments.
+    workspace.dijkstra_distances_.Clear();
+
+    // Distances and query indices are small non-negative integers, so the
+    // cells are kept in buckets indexed by the distance, and the cells sharing
+    // a distance in buckets indexed by the query index. The cells with the
+    // larger query index are popped first among them, as they are the closest
+    // to the last row, then the ones with the smaller vertex id, then the
+    // reverse complementary ones.
+    typename Workspace::DijkstraQueue &Q = workspace.dijkstra_queue_;
+    Q.Clear();
 
     stats.forward_num_cells = 0;
     stats.rc_num_cells = 0;
@@ -870,27 +2542,15 @@ class SequenceGraph {
          ++vertex) {
       // Deal with forward strand fisrt.
       ScoreType cost = 0;
-      const char vertex_label = labels_[vertex];
+      const char vertex_label = graph_.labels[vertex];
 
       if (sequence_bases[0] != vertex_label) {
         cost = substitution_penalty_;
       }
       cost = std::min(cost, insertion_penalty_);
-
-      Q.push({/*graph_vertex_id=*/vertex, /*query_index=*/0, /*distance=*/cost,
-              /*is_reverse_complementary=*/false});
-
-      ++(stats.forward_num_cells);
-
-      // int khash_return_code = 0;
-      // khiter_t forward_vertex_distances_iterator =
-      //    kh_put(k32, forward_vertex_distances[vertex], 0,
-      //    &khash_return_code);
-      // assert(khash_return_code != -1 && khash_return_code != 0);
-      // kh_value(forward_vertex_distances[vertex],
-      //         forward_vertex_distances_iterator) = cost;
-
-      forward_vertex_distances[vertex][0] = cost;
+      RelaxCellForDijkstra(vertex, /*query_index=*/0, cost,
+                           /*is_reverse_complementary=*/false, stats,
+                           workspace);
 
       // Now deal with reverse complementary strand.
       cost = 0;
@@ -901,164 +2561,65 @@ class SequenceGraph {
         cost = substitution_penalty_;
       }
       cost = std::min(cost, insertion_penalty_);
-
-      Q.push({/*graph_vertex_id=*/vertex, /*query_index=*/0, /*distance=*/cost,
-              /*is_reverse_complementary=*/true});
-
-      // khash_return_code = 0;
-      // khiter_t complementary_vertex_distances_iterator = kh_put(
-      //    k32, complementary_vertex_distances[vertex], 0, &khash_return_code);
-      // assert(khash_return_code != -1 && khash_return_code != 0);
-      // kh_value(complementary_vertex_distances[vertex],
-      //         complementary_vertex_distances_iterator) = cost;
-
-      complementary_vertex_distances[vertex][0] = cost;
-      ++(stats.rc_num_cells);
-
-      // vertex_parent[vertex][0] =
-      //    VertexWithDistanceForDijkstra<GraphSizeType, QueryLengthType,
-      //                                  ScoreType>{
-      //        /*graph_vertex_id=*/vertex, /*query_index=*/0,
-      //        /*distance=*/cost};
-      // std::cerr << "Init PUSH: " << vertex << " " << 0 << " " << cost
-      //          << std::endl;
+      RelaxCellForDijkstra(vertex, /*query_index=*/0, cost,
+                           /*is_reverse_complementary=*/true, stats,
+                           workspace);
     }
 
     ScoreType min_alignment_cost = 0;
 
-    while (!Q.empty()) {
-      const auto current_vertex = Q.top();
-      Q.pop();
-
-      // Check if we reach the last layer where we can stop.
-      if (current_vertex.query_index + 1 == sequence_length) {
-        min_alignment_cost = current_vertex.distance;
-        // auto previous_it =
-        //    VertexWithDistanceForDijkstra<GraphSizeType, QueryLengthType,
-        //                                  ScoreType>{-1, -1, 0};
-        // auto it = current_vertex;
-        // while (!(it.graph_vertex_id == previous_it.graph_vertex_id &&
-        //         it.query_index == previous_it.query_index)) {
-        //  std::cerr << "Traceback: "
-        //            << "gi: " << it.graph_vertex_id << " qi: " <<
-        //            it.query_index
-        //            << " d: " << it.distance
-        //            << " qb: " << sequence_bases[it.query_index]
-        //            << " gb: " << labels_[it.graph_vertex_id];
-
-        //  if (it.distance + substitution_penalty_ == previous_it.distance) {
-        //    std::cerr << " op: M";
-        //  }
-
-        //  if (it.graph_vertex_id == previous_it.graph_vertex_id &&
-        //      it.distance + deletion_penalty_ == previous_it.distance) {
-        //    std::cerr << " op: D";
-        //  }
-
-        //  if (it.query_index == previous_it.query_index) {
-        //    std::cerr << " op: I";
-        //  }
-        //  std::cerr << std::endl;
-        //  previous_it = it;
-        //  it = vertex_parent[it.graph_vertex_id][it.query_index];
-        //}
-        // std::cerr << std::endl;
-        break;
+    while (!Q.Empty()) {
+      ScoreType current_distance = 0;
+      const auto current_vertex = Q.Pop(current_distance);
+      // A cell is pushed again each time its distance is lowered, so skip the
+      // stale copies with a distance above the stored one.
+      const ScoreType *stored_distance = workspace.dijkstra_distances_.Find(
+          GetDijkstraCellKey(current_vertex.graph_vertex_id,
+                             current_vertex.query_index,
+                             current_vertex.is_reverse_complementary));
+      assert(stored_distance != nullptr);
+      if (current_distance > *stored_distance) {
+        continue;
       }
 
-      auto &vertex_distances = current_vertex.is_reverse_complementary
-                                   ? complementary_vertex_distances
-                                   : forward_vertex_distances;
+      // Check if we reach the last layer where we can stop. The cells are
+      // popped in order of distance, so once the queue min is above max_cost
+      // the cost is too.
+      if (current_vertex.query_index + 1 == sequence_length ||
+          current_distance > max_cost) {
+        min_alignment_cost = current_distance;
+        break;
+      }
 
       const ScoreType min_insertion_distance =
           (ScoreType)(insertion_penalty_ * (current_vertex.query_index + 1));
       if (current_vertex.distance > min_insertion_distance) {
-        Q.push(
-            {/*graph_vertex_id=*/start_vertex,
-             /*query_index=*/(QueryLengthType)(current_vertex.query_index + 1),
-             /*distance=*/min_insertion_distance,
-             /*is_reverse_complementary=*/
-             current_vertex.is_reverse_complementary});
-        vertex_distances[start_vertex][current_vertex.query_index + 1] =
-            min_insertion_distance;
+        // Always overwrite the distance here, without counting the cell.
+        bool is_inserted = false;
+        workspace.dijkstra_distances_.FindOrInsert(
+            GetDijkstraCellKey(start_vertex, current_vertex.query_index + 1,
+                               current_vertex.is_reverse_complementary),
+            is_inserted) = min_insertion_distance;
+        Q.Push(min_insertion_distance,
+               (QueryLengthType)(current_vertex.query_index + 1),
+               {/*graph_vertex_id=*/start_vertex,
+                /*query_index=*/
+                (QueryLengthType)(current_vertex.query_index + 1),
+                /*distance=*/min_insertion_distance,
+                /*is_reverse_complementary=*/
+                current_vertex.is_reverse_complementary});
       }
 
       // Explore its neighbors.
-      for (const auto &neighbor :
-           adjacency_list_[current_vertex.graph_vertex_id]) {
+      for (const GraphSizeType neighbor :
+           graph_.GetNeighbors(current_vertex.graph_vertex_id)) {
         // Process neighbors in the same layaer.
         const ScoreType new_deletion_distance =
             current_vertex.distance + deletion_penalty_;
-
-        // khiter_t vertex_distances_iterator =
-        //    kh_get(k32, vertex_distances[neighbor],
-        //    current_vertex.query_index);
-        // if (vertex_distances_iterator != kh_end(vertex_distances[neighbor]))
-        // {
-        //  if (new_deletion_distance <
-        //      kh_value(vertex_distances[neighbor], vertex_distances_iterator))
-        //      {
-        //    kh_value(vertex_distances[neighbor], vertex_distances_iterator) =
-        //        new_deletion_distance;
-        if (vertex_distances[neighbor].find(current_vertex.query_index) !=
-            vertex_distances[neighbor].end()) {
-          if (new_deletion_distance <
-              vertex_distances[neighbor][current_vertex.query_index]) {
-            vertex_distances[neighbor][current_vertex.query_index] =
-                new_deletion_distance;
-
-            Q.push({/*graph_vertex_id=*/neighbor,
-                    /*query_index=*/current_vertex.query_index,
-                    /*distance=*/new_deletion_distance,
-                    /*is_reverse_complementary=*/
-                    current_vertex.is_reverse_complementary});
-            // vertex_parent[neighbor][current_vertex.query_index] =
-            //    VertexWithDistanceForDijkstra<GraphSizeType, QueryLengthType,
-            //                                  ScoreType>{
-            //        /*graph_vertex_id=*/current_vertex.graph_vertex_id,
-            //        /*query_index=*/current_vertex.query_index,
-            //        /*distance=*/current_vertex.distance};
-            // std::cerr << "PUSH: " << neighbor << " "
-            //          << current_vertex.query_index << " "
-            //          << new_deletion_distance << std::endl;
-            if (current_vertex.is_reverse_complementary) {
-              ++(stats.rc_num_cells);
-            } else {
-              ++(stats.forward_num_cells);
-            }
-          }
-        } else {
-          // int khash_return_code = 0;
-          // khiter_t vertex_distances_iterator =
-          //    kh_put(k32, vertex_distances[neighbor],
-          //           current_vertex.query_index, &khash_return_code);
-          // assert(khash_return_code != -1 && khash_return_code != 0);
-          // kh_value(vertex_distances[neighbor], vertex_distances_iterator) =
-          //    new_deletion_distance;
-
-          vertex_distances[neighbor][current_vertex.query_index] =
-              new_deletion_distance;
-          Q.push({/*graph_vertex_id=*/neighbor,
-                  /*query_index=*/current_vertex.query_index,
-                  /*distance=*/new_deletion_distance,
-                  /*is_reverse_complementary=*/
-                  current_vertex.is_reverse_complementary});
-          // vertex_parent[neighbor][current_vertex.query_index] =
-          //    VertexWithDistanceForDijkstra<GraphSizeType, QueryLengthType,
-          //                                  ScoreType>{
-          //        /*graph_vertex_id=*/current_vertex.graph_vertex_id,
-          //        /*query_index=*/current_vertex.query_index,
-          //        /*distance=*/current_vertex.distance};
-
-          // std::cerr << "PUSH: " << neighbor << " " <<
-          // current_vertex.query_index
-          //          << " " << new_deletion_distance << std::endl;
-          if (current_vertex.is_reverse_complementary) {
-            ++(stats.rc_num_cells);
-          } else {
-            ++(stats.forward_num_cells);
-          }
-        }
+        RelaxCellForDijkstra(neighbor, current_vertex.query_index,
+                             new_deletion_distance,
+                             current_vertex.is_reverse_complementary, stats,
+                             workspace);
 
         // Process neighbors in the next layaer.
         const QueryLengthType query_index = current_vertex.query_index + 1;
@@ -1067,7 +2628,7 @@ class SequenceGraph {
         const char vertex_label =
             current_vertex.is_reverse_complementary
                 ? GetReverseComplementaryVertexLabel(neighbor)
-                : labels_[neighbor];
+                : graph_.labels[neighbor];
         const char sequence_base =
             current_vertex.is_reverse_complementary
                 ? sequence_bases[sequence_length - 1 - query_index]
@@ -1081,81 +2642,10 @@ class SequenceGraph {
             std::min(current_vertex.distance,
                      (ScoreType)(insertion_penalty_ * query_index)) +
             cost;
-
-        // std::cerr << "seq base: " << sequence_bases[query_index] << " label:
-        // " << labels_[neighbor] << " cost: " << cost << " d: " <<
-        // new_match_or_mismatch_distance << std::endl;
-
-        // vertex_distances_iterator =
-        //    kh_get(k32, vertex_distances[neighbor], query_index);
-        // if (vertex_distances_iterator != kh_end(vertex_distances[neighbor]))
-        // {
-        //  if (new_match_or_mismatch_distance <
-        //      kh_value(vertex_distances[neighbor], vertex_distances_iterator))
-        //      {
-        //    kh_value(vertex_distances[neighbor], vertex_distances_iterator) =
-        //        new_match_or_mismatch_distance;
-
-        if (vertex_distances[neighbor].find(query_index) !=
-            vertex_distances[neighbor].end()) {
-          if (new_match_or_mismatch_distance <
-              vertex_distances[neighbor][query_index]) {
-            vertex_distances[neighbor][query_index] =
-                new_match_or_mismatch_distance;
-
-            Q.push({/*graph_vertex_id=*/neighbor,
-                    /*query_index=*/query_index,
-                    /*distance=*/new_match_or_mismatch_distance,
-                    /*is_reverse_complementary=*/
-                    current_vertex.is_reverse_complementary});
-            // vertex_parent[neighbor][query_index] =
-            //    VertexWithDistanceForDijkstra<GraphSizeType, QueryLengthType,
-            //                                  ScoreType>{
-            //        /*graph_vertex_id=*/current_vertex.graph_vertex_id,
-            //        /*query_index=*/current_vertex.query_index,
-            //        /*distance=*/current_vertex.distance};
-
-            // std::cerr << "PUSH: " << neighbor << " " << query_index << " "
-            //          << new_match_or_mismatch_distance << std::endl;
-
-            if (current_vertex.is_reverse_complementary) {
-              ++(stats.rc_num_cells);
-            } else {
-              ++(stats.forward_num_cells);
-            }
-          }
-        } else {
-          // int khash_return_code = 0;
-          // khiter_t vertex_distances_iterator = kh_put(
-          //    k32, vertex_distances[neighbor], query_index,
-          //    &khash_return_code);
-          // assert(khash_return_code != -1 && khash_return_code != 0);
-          // kh_value(vertex_distances[neighbor], vertex_distances_iterator) =
-          //    new_match_or_mismatch_distance;
-
-          vertex_distances[neighbor][query_index] =
-              new_match_or_mismatch_distance;
-
-          Q.push({/*graph_vertex_id=*/neighbor,
-                  /*query_index=*/query_index,
-                  /*distance=*/new_match_or_mismatch_distance,
-                  /*is_reverse_complementary=*/
-                  current_vertex.is_reverse_complementary});
-          // vertex_parent[neighbor][query_index] =
-          //    VertexWithDistanceForDijkstra<GraphSizeType, QueryLengthType,
-          //                                  ScoreType>{
-          //        /*graph_vertex_id=*/current_vertex.graph_vertex_id,
-          //        /*query_index=*/current_vertex.query_index,
-          //        /*distance=*/current_vertex.distance};
-
-          // std::cerr << "PUSH: " << neighbor << " " << query_index << " "
-          //          << new_match_or_mismatch_distance << std::endl;
-          if (current_vertex.is_reverse_complementary) {
-            ++(stats.rc_num_cells);
-          } else {
-            ++(stats.forward_num_cells);
-          }
-        }
+        RelaxCellForDijkstra(neighbor, query_index,
+                             new_match_or_mismatch_distance,
+                             current_vertex.is_reverse_complementary, stats,
+                             workspace);
       }  // End for exploring neighbor.
 
       // Process insertions to the next layaer.
@@ -1163,126 +2653,98 @@ class SequenceGraph {
 
       const ScoreType new_insertion_distance =
           current_vertex.distance + insertion_penalty_;
-
-      // khiter_t vertex_distances_iterator = kh_get(
-      //    k32, vertex_distances[current_vertex.graph_vertex_id], query_index);
-      // if (vertex_distances_iterator !=
-      //    kh_end(vertex_distances[current_vertex.graph_vertex_id])) {
-      //  if (new_insertion_distance <
-      //      kh_value(vertex_distances[current_vertex.graph_vertex_id],
-      //               vertex_distances_iterator)) {
-      //    kh_value(vertex_distances[current_vertex.graph_vertex_id],
-      //             vertex_distances_iterator) = new_insertion_distance;
-
-      if (vertex_distances[current_vertex.graph_vertex_id].find(query_index) !=
-          vertex_distances[current_vertex.graph_vertex_id].end()) {
-        if (new_insertion_distance <
-            vertex_distances[current_vertex.graph_vertex_id][query_index]) {
-          vertex_distances[current_vertex.graph_vertex_id][query_index] =
-              new_insertion_distance;
-
-          Q.push({/*graph_vertex_id=*/current_vertex.graph_vertex_id,
-                  /*query_index=*/query_index,
-                  /*distance=*/new_insertion_distance,
-                  /*is_reverse_complementary=*/
-                  current_vertex.is_reverse_complementary});
-          // vertex_parent[current_vertex.graph_vertex_id][query_index] =
-          //    VertexWithDistanceForDijkstra<GraphSizeType, QueryLengthType,
-          //                                  ScoreType>{
-          //        /*graph_vertex_id=*/current_vertex.graph_vertex_id,
-          //        /*query_index=*/current_vertex.query_index,
-          //        /*distance=*/current_vertex.distance};
-
-          // std::cerr << "PUSH: " << current_vertex.graph_vertex_id << " "
-          //          << query_index << " " << new_insertion_distance
-          //          << std::endl;
-          if (current_vertex.is_reverse_complementary) {
-            ++(stats.rc_num_cells);
-          } else {
-            ++(stats.forward_num_cells);
-          }
-        }
-      } else {
-        // int khash_return_code = 0;
-        // khiter_t vertex_distances_iterator =
-        //    kh_put(k32, vertex_distances[current_vertex.graph_vertex_id],
-        //           query_index, &khash_return_code);
-        // assert(khash_return_code != -1 && khash_return_code != 0);
-        // kh_value(vertex_distances[current_vertex.graph_vertex_id],
-        //         vertex_distances_iterator) = new_insertion_distance;
-
-        vertex_distances[current_vertex.graph_vertex_id][query_index] =
-            new_insertion_distance;
-
-        Q.push({/*graph_vertex_id=*/current_vertex.graph_vertex_id,
-                /*query_index=*/query_index,
-                /*distance=*/new_insertion_distance,
-                /*is_reverse_complementary=*/
-                current_vertex.is_reverse_complementary});
-        // vertex_parent[current_vertex.graph_vertex_id][query_index] =
-        //    VertexWithDistanceForDijkstra<GraphSizeType, QueryLengthType,
-        //                                  ScoreType>{
-        //        /*graph_vertex_id=*/current_vertex.graph_vertex_id,
-        //        /*query_index=*/current_vertex.query_index,
-        //        /*distance=*/current_vertex.distance};
-
-        // std::cerr << "PUSH: " << current_vertex.graph_vertex_id << " "
-        //          << query_index << " " << new_insertion_distance <<
-        //          std::endl;
-        if (current_vertex.is_reverse_complementary) {
-          ++(stats.rc_num_cells);
-        } else {
-          ++(stats.forward_num_cells);
-        }
-      }
+      RelaxCellForDijkstra(current_vertex.graph_vertex_id, query_index,
+                           new_insertion_distance,
+                           current_vertex.is_reverse_complementary, stats,
+                           workspace);
     }
 
-    // for (GraphSizeType vi = 0; vi < num_vertices; ++vi) {
-    //  kh_destroy(k32, forward_vertex_distances[vi]);
-    //  kh_destroy(k32, complementary_vertex_distances[vi]);
-    //}
-
-    // std::cerr << "Sequence length: " << sequence_length
-    //          << ", forward alignment cost:" << forward_alignment_cost
-    //          << ", reverse complement alignment cost:"
-    //          << reverse_complement_alignment_cost
-    //          << ", alignment cost:" << min_alignment_cost << std::endl;
     return min_alignment_cost;
   }
 
+  // Both strands are explored together, so max_cost only bounds the cost as
+  // in AlignUsingLinearGapPenalty.
   ScoreType AlignUsingLinearGapPenaltyWithDijkstraAlgorithm(
-      const sga::Sequence &sequence) {
-    const QueryLengthType sequence_length = sequence.GetLength();
-    const std::string &sequence_bases = sequence.GetSequence();
+      const sga::Sequence &sequence, Workspace &workspace,
+      const ScoreType max_cost = std::numeric_limits<ScoreType>::max()) const {
     DijkstraAlgorithmStatistics<GraphSizeType> stats;
     const ScoreType min_alignment_cost =
         AlignUsingLinearGapPenaltyWithDijkstraAlgorithm(
-            sequence, GetNumVertices(), stats);
-
-    std::cerr << "Sequence length: " << sequence_length
-              << ", alignment cost:" << min_alignment_cost
-              << ", forward num cells:" << stats.forward_num_cells
-              << ", reverse num cells: " << stats.rc_num_cells << std::endl;
+            sequence, graph_.num_vertices, stats, workspace, max_cost);
     return min_alignment_cost;
   }
 
+  // Same as above but uses the workspace owned by the graph, thus it is not
+  // thread-safe.
+  ScoreType AlignUsingLinearGapPenaltyWithDijkstraAlgorithm(
+      const sga::Sequence &sequence,
+      const ScoreType max_cost = std::numeric_limits<ScoreType>::max()) {
+    return AlignUsingLinearGapPenaltyWithDijkstraAlgorithm(
+        sequence, default_workspace_, max_cost);
+  }
+
+  // The start vertex is given by its original id.
   ScoreType ExtendUsingLinearGapPenaltyWithDijkstraAlgorithm(
-      const sga::Sequence &sequence, GraphSizeType start_vertex) {
-    const QueryLengthType sequence_length = sequence.GetLength();
-    const std::string &sequence_bases = sequence.GetSequence();
+      const sga::Sequence &sequence, GraphSizeType start_vertex,
+      Workspace &workspace,
+      const ScoreType max_cost = std::numeric_limits<ScoreType>::max()) const {
     DijkstraAlgorithmStatistics<GraphSizeType> stats;
     const ScoreType min_alignment_cost =
-        AlignUsingLinearGapPenaltyWithDijkstraAlgorithm(sequence, start_vertex,
-                                                        stats);
-
-    std::cerr << "Sequence length: " << sequence_length
-              << ", alignment cost:" << min_alignment_cost
-              << ", forward num cells:" << stats.forward_num_cells
-              << ", reverse num cells: " << stats.rc_num_cells << std::endl;
+        AlignUsingLinearGapPenaltyWithDijkstraAlgorithm(
+            sequence, GetVertexId(start_vertex), stats, workspace, max_cost);
     return min_alignment_cost;
   }
 
+  // Same as above but uses the workspace owned by the graph, thus it is not
+  // thread-safe.
+  ScoreType ExtendUsingLinearGapPenaltyWithDijkstraAlgorithm(
+      const sga::Sequence &sequence, GraphSizeType start_vertex,
+      const ScoreType max_cost = std::numeric_limits<ScoreType>::max()) {
+    return ExtendUsingLinearGapPenaltyWithDijkstraAlgorithm(
+        sequence, start_vertex, default_workspace_, max_cost);
+  }
+
  protected:
+  static constexpr char kIndexMagic[8] = {'S', 'G', 'A', 'I', 'D', 'X', 0, 0};
+  static constexpr uint32_t kIndexVersion = 5;
+
+  // Write a section of the index, padded to a multiple of 8 bytes so that the
+  // next one stays aligned.
+  static void WriteIndexSection(std::ofstream &outstrm, const void *data,
+                                const size_t size) {
+    const char padding[8] = {0};
+    outstrm.write((const char *)data, size);
+    outstrm.write(padding, (8 - size % 8) % 8);
+  }
+
+  // Return the next section of the index mapping, with num_elements elements
+  // of element_size bytes, and move position past its padding. If the section
+  // does not fit in the bytes left, return nullptr and move position past the
+  // end of the mapping, so this and all the later sections are rejected.
+  const char *MapIndexSection(size_t &position, const uint64_t num_elements,
+                              const size_t element_size) const {
+    if (position > index_mapping_size_) {
+      return nullptr;
+    }
+    const size_t remaining_size = index_mapping_size_ - position;
+    if (num_elements > remaining_size / element_size ||
+        (num_elements * element_size + 7) / 8 * 8 > remaining_size) {
+      position = index_mapping_size_ + 1;
+      return nullptr;
+    }
+    const char *section = (const char *)index_mapping_ + position;
+    position += (num_elements * element_size + 7) / 8 * 8;
+    return section;
+  }
+
+  void UnmapIndex() {
+    if (index_mapping_ != nullptr) {
+      munmap(index_mapping_, index_mapping_size_);
+      index_mapping_ = nullptr;
+      index_mapping_size_ = 0;
+    }
+  }
+
   char base_complement_[256] = {
       4, 4, 4,   4, 4,   4, 4, 4, 4,   4, 4,   4, 4, 4, 4,   4,   4, 4, 4,
       4, 4, 4,   4, 4,   4, 4, 4, 4,   4, 4,   4, 4, 4, 4,   4,   4, 4, 4,
@@ -1311,34 +2773,62 @@ class SequenceGraph {
       4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
       4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4};
 
-  // For graph representation
-  std::vector<GraphSizeType> look_up_table_;
-  std::vector<GraphSizeType> neighbor_table_;
+  // The labels of graph_ packed for computing the mismatches of a row.
+  PackedLabels packed_labels_;
+  // The id ranges of the strongly connected components with cycles, as begin
+  // and end pairs, see FindCyclicComponents.
+  GraphSizeType num_cyclic_components_ = 0;
+  const GraphSizeType *cyclic_component_bounds_view_ = nullptr;
+  std::vector<GraphSizeType> cyclic_component_bounds_;
+  bool is_acyclic_ = false;
+  // Whether the layers are computed with ComputeLayerOnCondensedGraph instead
+  // of the kernels for general graphs.
+  bool use_component_sweep_ = true;
+  // The original id of each vertex of graph_ and the inverse mapping, see
+  // RenumberVertices.
+  const GraphSizeType *original_vertex_ids_view_ = nullptr;
+  const GraphSizeType *vertex_ids_view_ = nullptr;
+  std::vector<GraphSizeType> original_vertex_ids_;
+  std::vector<GraphSizeType> vertex_ids_;
+
+  // For graph representation. graph_ is the implicit successor graph view
+  // over graph_arrays_ and labels_, or over an index mapping, used by the
+  // alignment kernels.
+  ImplicitSuccessorGraph<GraphSizeType> graph_;
+  ImplicitSuccessorGraphArrays<GraphSizeType> graph_arrays_;
   std::vector<std::vector<GraphSizeType>> adjacency_list_;
   std::vector<char> labels_;
   std::vector<std::vector<GraphSizeType>> compacted_graph_adjacency_list_;
   std::vector<std::string> compacted_graph_labels_;
-
-  // For reverse complementary graph representation. We make the vertex ids
-  // stable, and thus the vertex labels are just the corresponding reverse
-  // complementary base in labels_. However, we construct a separate adjacency
-  // list for fast neighbor queries in the reverse complementary graph.
-  std::vector<std::vector<GraphSizeType>> reverse_complementary_adjacency_list_;
-
-  // For RECOMB work
-  std::vector<GraphSizeType> order_look_up_table_;
-  std::vector<bool> visited_;
-  std::vector<GraphSizeType> parents_;
-  std::vector<int> types_;
-  std::vector<GraphSizeType> order_offsets_;
-  std::vector<GraphSizeType> order_counts_;
+  // The CSR view of the compacted graph and the chain offsets of its vertices
+  // in the char labeled graph, see GenerateCompressedRepresentation.
+  CompressedSparseRowGraph<GraphSizeType> compacted_graph_;
+  std::vector<GraphSizeType> compacted_look_up_table_;
+  std::vector<GraphSizeType> compacted_neighbor_table_;
+  const GraphSizeType *chain_offsets_view_ = nullptr;
+  std::vector<GraphSizeType> chain_offsets_;
+  // The graph views point into this mapping when the graph is loaded from an
+  // index.
+  void *index_mapping_ = nullptr;
+  size_t index_mapping_size_ = 0;
+
+  // The number of vertices on the forward strand of a bidirected graph, 0 if
+  // the graph is not bidirected. The vertices with original ids from it on
+  // are the reverse complementary strand.
+  GraphSizeType num_forward_vertices_ = 0;
+
+  // The workspace used by the alignment calls without a workspace.
+  Workspace default_workspace_;
 
   // For alignment
-  std::vector<std::pair<ScoreType, GraphSizeType>> distances_with_vertices_;
   ScoreType substitution_penalty_ = 1;
   ScoreType deletion_penalty_ = 1;
   ScoreType insertion_penalty_ = 1;
 };
 
+template <class GraphSizeType, class QueryLengthType, class ScoreType>
+constexpr char
+    SequenceGraph<GraphSizeType, QueryLengthType, ScoreType>::kIndexMagic[8];
+
 }  // namespace sga
 #endif  // SGA_SEQUENCEGRAPH_H
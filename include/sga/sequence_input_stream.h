@@ -0,0 +1,372 @@
+#ifndef SGA_SEQUENCEINPUTSTREAM_H_
+#define SGA_SEQUENCEINPUTSTREAM_H_
+
+#include <assert.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sga {
+
+// The input stream of a sequence file, which can be plain text, gzip or BGZF.
+// Plain text and gzip are read through zlib. A BGZF file is a series of
+// independent gzip blocks of at most 64KB, so it is read many blocks at a time
+// and the blocks are decompressed in parallel by a pool of threads, which
+// lives from Open to Close.
+class SequenceInputStream {
+ public:
+  SequenceInputStream()
+      : num_decompression_threads_(1),
+        gz_file_(nullptr),
+        bgzf_file_(nullptr),
+        is_eof_(false),
+        decompressed_data_position_(0),
+        num_bgzf_blocks_(0),
+        decompression_generation_(0),
+        num_busy_decompression_threads_(0),
+        stop_decompression_threads_(false) {}
+
+  ~SequenceInputStream() { Close(); }
+
+  bool IsBgzf() const { return bgzf_file_ != nullptr; }
+
+  // Return false if the file cannot be opened. The file opened before, if
+  // any, is closed first.
+  bool Open(const std::string &file_path,
+            const int num_decompression_threads) {
+    assert(num_decompression_threads > 0);
+    Close();
+    num_decompression_threads_ = num_decompression_threads;
+    is_eof_ = false;
+    bgzf_blocks_.clear();
+    decompressed_data_.clear();
+    decompressed_data_position_ = 0;
+
+    FILE *file = fopen(file_path.c_str(), "rb");
+    if (file == NULL) {
+      std::cerr << "Failed to open " << file_path << "." << std::endl;
+      return false;
+    }
+    uint8_t header[kBgzfBlockHeaderLength];
+    const size_t header_length =
+        fread(header, 1, kBgzfBlockHeaderLength, file);
+    if (IsBgzfBlockHeader(header, header_length)) {
+      rewind(file);
+      bgzf_file_ = file;
+      StartDecompressionThreads();
+      return true;
+    }
+
+    fclose(file);
+    // gzread reads files which are not compressed as they are.
+    gz_file_ = gzopen(file_path.c_str(), "r");
+    if (gz_file_ == NULL) {
+      std::cerr << "Failed to open " << file_path << "." << std::endl;
+      return false;
+    }
+    gzbuffer(gz_file_, 1 << 17);
+    return true;
+  }
+
+  void Close() {
+    StopDecompressionThreads();
+
+    if (gz_file_ != nullptr) {
+      gzclose(gz_file_);
+      gz_file_ = nullptr;
+    }
+
+    if (bgzf_file_ != nullptr) {
+      fclose(bgzf_file_);
+      bgzf_file_ = nullptr;
+    }
+  }
+
+  // Read at most length bytes into the buffer. Return the number of bytes
+  // read, which is 0 at the end of the file, or -1 on errors.
+  int Read(void *buffer, const int length) {
+    if (gz_file_ != nullptr) {
+      return gzread(gz_file_, buffer, length);
+    }
+
+    assert(bgzf_file_ != nullptr);
+    if (decompressed_data_position_ == decompressed_data_.size()) {
+      if (!LoadBgzfBlocks()) {
+        return -1;
+      }
+    }
+    const size_t num_bytes =
+        std::min((size_t)length,
+                 decompressed_data_.size() - decompressed_data_position_);
+    if (num_bytes > 0) {
+      memcpy(buffer, decompressed_data_.data() + decompressed_data_position_,
+             num_bytes);
+    }
+    decompressed_data_position_ += num_bytes;
+    return num_bytes;
+  }
+
+ protected:
+  static constexpr size_t kBgzfBlockHeaderLength = 18;
+  // The number of blocks each decompression thread gets per load.
+  static constexpr size_t kNumBgzfBlocksPerThread = 16;
+
+  struct BgzfBlock {
+    // The raw deflate data of the block.
+    std::vector<uint8_t> compressed_data;
+    uint32_t decompressed_length;
+    uint32_t crc;
+    size_t decompressed_data_offset;
+  };
+
+  // A BGZF block is a gzip member with FEXTRA set and a "BC" extra subfield
+  // holding the block size.
+  static bool IsBgzfBlockHeader(const uint8_t *header, const size_t length) {
+    return length == kBgzfBlockHeaderLength && header[0] == 31 &&
+           header[1] == 139 && header[2] == 8 && (header[3] & 4) != 0 &&
+           header[10] == 6 && header[11] == 0 && header[12] == 'B' &&
+           header[13] == 'C' && header[14] == 2 && header[15] == 0;
+  }
+
+  // Read the next block from the file. Return 1 if a block is read, 0 at the
+  // end of the file, or -1 if the block is truncated or corrupt.
+  int ReadBgzfBlock(BgzfBlock &block) {
+    uint8_t header[kBgzfBlockHeaderLength];
+    const size_t header_length =
+        fread(header, 1, kBgzfBlockHeaderLength, bgzf_file_);
+    if (header_length == 0) {
+      return 0;
+    }
+    if (!IsBgzfBlockHeader(header, header_length)) {
+      std::cerr << "Invalid BGZF block header." << std::endl;
+      return -1;
+    }
+    const size_t block_length = ((size_t)header[16] | header[17] << 8) + 1;
+    // The deflate data is followed by the CRC32 and the decompressed length.
+    if (block_length < kBgzfBlockHeaderLength + 8) {
+      std::cerr << "Invalid BGZF block size " << block_length << "."
+                << std::endl;
+      return -1;
+    }
+    block.compressed_data.resize(block_length - kBgzfBlockHeaderLength - 8);
+    uint8_t footer[8];
+    const size_t num_bytes =
+        fread(block.compressed_data.data(), 1, block.compressed_data.size(),
+              bgzf_file_) +
+        fread(footer, 1, 8, bgzf_file_);
+    if (num_bytes != block_length - kBgzfBlockHeaderLength) {
+      std::cerr << "Truncated BGZF block." << std::endl;
+      return -1;
+    }
+    block.crc = (uint32_t)footer[0] | (uint32_t)footer[1] << 8 |
+                (uint32_t)footer[2] << 16 | (uint32_t)footer[3] << 24;
+    block.decompressed_length = (uint32_t)footer[4] |
+                                (uint32_t)footer[5] << 8 |
+                                (uint32_t)footer[6] << 16 |
+                                (uint32_t)footer[7] << 24;
+    // A BGZF block never holds more than 64KB of data.
+    if (block.decompressed_length > (1 << 16)) {
+      std::cerr << "Invalid BGZF block length " << block.decompressed_length
+                << "." << std::endl;
+      return -1;
+    }
+    return 1;
+  }
+
+  bool DecompressBgzfBlock(const BgzfBlock &block) {
+    uint8_t *output =
+        decompressed_data_.data() + block.decompressed_data_offset;
+    if (block.decompressed_length == 0) {
+      return true;
+    }
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    // Negative window bits for raw deflate data without the gzip wrapper.
+    if (inflateInit2(&stream, -15) != Z_OK) {
+      return false;
+    }
+    stream.next_in = const_cast<Bytef *>(block.compressed_data.data());
+    stream.avail_in = block.compressed_data.size();
+    stream.next_out = output;
+    stream.avail_out = block.decompressed_length;
+    const int status = inflate(&stream, Z_FINISH);
+    inflateEnd(&stream);
+    return status == Z_STREAM_END && stream.avail_out == 0 &&
+           crc32(crc32(0L, Z_NULL, 0), output, block.decompressed_length) ==
+               block.crc;
+  }
+
+  // The calling thread is the first decompression thread, so only the others
+  // are started.
+  void StartDecompressionThreads() {
+    stop_decompression_threads_ = false;
+    decompression_generation_ = 0;
+    decompression_threads_.reserve(num_decompression_threads_ - 1);
+    for (int thread_id = 1; thread_id < num_decompression_threads_;
+         ++thread_id) {
+      decompression_threads_.emplace_back(
+          &SequenceInputStream::RunDecompressionThread, this, thread_id);
+    }
+  }
+
+  void StopDecompressionThreads() {
+    if (decompression_threads_.empty()) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(decompression_mutex_);
+      stop_decompression_threads_ = true;
+    }
+    decompression_start_.notify_all();
+    for (std::thread &thread : decompression_threads_) {
+      thread.join();
+    }
+    decompression_threads_.clear();
+  }
+
+  // Wait for each load of blocks, signalled by a new generation, and
+  // decompress the blocks of the thread.
+  void RunDecompressionThread(const int thread_id) {
+    uint64_t generation = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(decompression_mutex_);
+        decompression_start_.wait(lock, [&] {
+          return stop_decompression_threads_ ||
+                 decompression_generation_ != generation;
+        });
+        if (stop_decompression_threads_) {
+          return;
+        }
+        generation = decompression_generation_;
+      }
+      DecompressBgzfBlocks(thread_id);
+      {
+        std::lock_guard<std::mutex> lock(decompression_mutex_);
+        --num_busy_decompression_threads_;
+      }
+      decompression_done_.notify_one();
+    }
+  }
+
+  // Decompress every num_decompression_threads_-th block of the load,
+  // starting from block thread_id.
+  void DecompressBgzfBlocks(const int thread_id) {
+    for (size_t bi = thread_id; bi < num_bgzf_blocks_;
+         bi += num_decompression_threads_) {
+      is_bgzf_block_decompressed_[bi] = DecompressBgzfBlock(bgzf_blocks_[bi]);
+    }
+  }
+
+  // Read and decompress the next blocks into decompressed_data_. Return false
+  // on errors.
+  bool LoadBgzfBlocks() {
+    decompressed_data_position_ = 0;
+    // Keep loading when all the blocks read are empty, e.g. the EOF marker
+    // block.
+    do {
+      decompressed_data_.clear();
+      if (is_eof_) {
+        return true;
+      }
+      if (!ReadAndDecompressBgzfBlocks()) {
+        return false;
+      }
+    } while (decompressed_data_.empty());
+    return true;
+  }
+
+  bool ReadAndDecompressBgzfBlocks() {
+    const size_t max_num_blocks =
+        num_decompression_threads_ * kNumBgzfBlocksPerThread;
+    if (bgzf_blocks_.size() < max_num_blocks) {
+      bgzf_blocks_.resize(max_num_blocks);
+    }
+    size_t num_blocks = 0;
+    size_t decompressed_length = 0;
+    while (num_blocks < max_num_blocks) {
+      BgzfBlock &block = bgzf_blocks_[num_blocks];
+      const int status = ReadBgzfBlock(block);
+      if (status < 0) {
+        return false;
+      }
+      if (status == 0) {
+        is_eof_ = true;
+        break;
+      }
+      block.decompressed_data_offset = decompressed_length;
+      decompressed_length += block.decompressed_length;
+      ++num_blocks;
+    }
+    decompressed_data_.resize(decompressed_length);
+    num_bgzf_blocks_ = num_blocks;
+    is_bgzf_block_decompressed_.assign(num_blocks, 0);
+
+    if (num_blocks > 1 && !decompression_threads_.empty()) {
+      {
+        std::lock_guard<std::mutex> lock(decompression_mutex_);
+        num_busy_decompression_threads_ = decompression_threads_.size();
+        ++decompression_generation_;
+      }
+      decompression_start_.notify_all();
+      DecompressBgzfBlocks(/*thread_id=*/0);
+      std::unique_lock<std::mutex> lock(decompression_mutex_);
+      decompression_done_.wait(
+          lock, [&] { return num_busy_decompression_threads_ == 0; });
+    } else {
+      for (size_t bi = 0; bi < num_blocks; ++bi) {
+        is_bgzf_block_decompressed_[bi] = DecompressBgzfBlock(bgzf_blocks_[bi]);
+      }
+    }
+
+    for (size_t bi = 0; bi < num_blocks; ++bi) {
+      if (!is_bgzf_block_decompressed_[bi]) {
+        std::cerr << "Failed to decompress BGZF block " << bi << "."
+                  << std::endl;
+        return false;
+      }
+    }
+    return true;
+  }
+
+  int num_decompression_threads_;
+  // For plain text and gzip
+  gzFile gz_file_;
+  // For BGZF
+  FILE *bgzf_file_;
+  bool is_eof_;
+  std::vector<BgzfBlock> bgzf_blocks_;
+  std::vector<uint8_t> decompressed_data_;
+  size_t decompressed_data_position_;
+  // The blocks of the current load, in bgzf_blocks_.
+  size_t num_bgzf_blocks_;
+  std::vector<char> is_bgzf_block_decompressed_;
+  // The decompression threads other than the calling one. Each load of
+  // blocks bumps the generation to start them and waits until none is busy.
+  std::vector<std::thread> decompression_threads_;
+  std::mutex decompression_mutex_;
+  std::condition_variable decompression_start_;
+  std::condition_variable decompression_done_;
+  uint64_t decompression_generation_;
+  size_t num_busy_decompression_threads_;
+  bool stop_decompression_threads_;
+};
+
+// The read function used by kseq.
+inline int ReadSequenceInputStream(SequenceInputStream *stream, void *buffer,
+                                   const int length) {
+  return stream->Read(buffer, length);
+}
+
+}  // namespace sga
+
+#endif  // SGA_SEQUENCEINPUTSTREAM_H_
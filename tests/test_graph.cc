@@ -1,9 +1,47 @@
+#include <cstddef>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <string>
+
 #include "gtest/gtest.h"
+#include "batch_aligner.h"
+#include "packed_labels.h"
 #include "sequence_batch.h"
 #include "sequence_graph.h"
 
 namespace sga_testing {
 
+// Exposes the edges of the char labeled graph to check the vertex layout.
+class SequenceGraphWithEdges : public sga::SequenceGraph<> {
+ public:
+  int32_t GetNumEdgesToNextVertex() const {
+    int32_t num_edges = 0;
+    for (int32_t vertex = 0; vertex < graph_.num_vertices; ++vertex) {
+      for (const int32_t neighbor : graph_.GetNeighbors(vertex)) {
+        num_edges += neighbor == vertex + 1 ? 1 : 0;
+      }
+    }
+    return num_edges;
+  }
+
+  int32_t GetNumExplicitEdges() const {
+    return graph_.explicit_offsets[graph_.GetNumExplicitVertices()];
+  }
+
+  int32_t GetNumVisitedEdges() const {
+    int32_t num_edges = 0;
+    for (int32_t vertex = 0; vertex < graph_.num_vertices; ++vertex) {
+      for (const int32_t neighbor : graph_.GetNeighbors(vertex)) {
+        EXPECT_LT(neighbor, graph_.num_vertices);
+        ++num_edges;
+      }
+    }
+    return num_edges;
+  }
+};
+
 class SequenceGraphTest : public ::testing::Test {
  protected:
   SequenceGraphTest()
@@ -81,6 +119,178 @@ TEST_F(SequenceGraphTest, GenerateCharLabeledGraphOnGfaGraphTest) {
       << num_edges;
 }
 
+TEST_F(SequenceGraphTest, RenumberVerticesTest) {
+  ASSERT_TRUE(txt_sequence_graph_.IsAcyclic());
+  const int32_t num_vertices = txt_sequence_graph_.GetNumVertices();
+  for (int32_t i = 0; i < num_vertices; ++i) {
+    ASSERT_EQ(txt_sequence_graph_.GetVertexId(
+                  txt_sequence_graph_.GetOriginalVertexId(i)),
+              i);
+  }
+  EXPECT_EQ(txt_sequence_graph_.GetOriginalVertexId(0), 0);
+
+  sga::SequenceGraph<> cyclic_sequence_graph;
+  cyclic_sequence_graph.LoadFromTxtFile("cyclic_seq_graph.txt");
+  cyclic_sequence_graph.GenerateCharLabeledGraph();
+  cyclic_sequence_graph.GenerateCompressedRepresentation();
+  ASSERT_FALSE(cyclic_sequence_graph.IsAcyclic());
+  for (int32_t i = 0; i < cyclic_sequence_graph.GetNumVertices(); ++i) {
+    ASSERT_EQ(cyclic_sequence_graph.GetVertexId(
+                  cyclic_sequence_graph.GetOriginalVertexId(i)),
+              i);
+  }
+  EXPECT_EQ(cyclic_sequence_graph.GetOriginalVertexId(0), 0);
+}
+
+TEST_F(SequenceGraphTest, RenumberVerticesInDepthFirstOrderTest) {
+  SequenceGraphWithEdges breadth_first_sequence_graph;
+  breadth_first_sequence_graph.LoadFromTxtFile(txt_sequence_graph_file_path_);
+  breadth_first_sequence_graph.GenerateCharLabeledGraph();
+  breadth_first_sequence_graph.GenerateCompressedRepresentation(
+      sga::VertexOrder::kBreadthFirst);
+  SequenceGraphWithEdges depth_first_sequence_graph;
+  depth_first_sequence_graph.LoadFromTxtFile(txt_sequence_graph_file_path_);
+  depth_first_sequence_graph.GenerateCharLabeledGraph();
+  depth_first_sequence_graph.GenerateCompressedRepresentation(
+      sga::VertexOrder::kDepthFirst);
+
+  // Each unitig is laid out contiguously, so almost every edge goes to the
+  // next vertex.
+  const int32_t num_edges = depth_first_sequence_graph.GetNumEdges();
+  EXPECT_GT(depth_first_sequence_graph.GetNumEdgesToNextVertex(),
+            num_edges / 100 * 99);
+  EXPECT_GT(depth_first_sequence_graph.GetNumEdgesToNextVertex(),
+            breadth_first_sequence_graph.GetNumEdgesToNextVertex());
+
+  sequence_batch_.LoadBatch();
+  breadth_first_sequence_graph.SetAlignmentParameters(1, 1, 1);
+  depth_first_sequence_graph.SetAlignmentParameters(1, 1, 1);
+  EXPECT_EQ(
+      depth_first_sequence_graph.AlignUsingLinearGapPenaltyWithNavarroAlgorithm(
+          sequence_batch_.GetSequence(3)),
+      breadth_first_sequence_graph
+          .AlignUsingLinearGapPenaltyWithNavarroAlgorithm(
+              sequence_batch_.GetSequence(3)));
+}
+
+TEST_F(SequenceGraphTest, ImplicitSuccessorGraphTest) {
+  SequenceGraphWithEdges sequence_graph;
+  sequence_graph.LoadFromTxtFile(txt_sequence_graph_file_path_);
+  sequence_graph.GenerateCharLabeledGraph();
+  sequence_graph.GenerateCompressedRepresentation();
+
+  // Only the edges that do not go to the next vertex are stored.
+  const int32_t num_edges = sequence_graph.GetNumEdges();
+  EXPECT_EQ(sequence_graph.GetNumVisitedEdges(), num_edges);
+  EXPECT_EQ(sequence_graph.GetNumExplicitEdges(),
+            num_edges - sequence_graph.GetNumEdgesToNextVertex());
+  EXPECT_LT(sequence_graph.GetNumExplicitEdges(), num_edges / 100);
+}
+
+TEST_F(SequenceGraphTest, SaveAndLoadIndexTest) {
+  const std::string index_file_path = "BRCA1_seq_graph_test.sgaidx";
+  ASSERT_TRUE(gfa_sequence_graph_.SaveIndex(index_file_path));
+  EXPECT_FALSE(gfa_sequence_graph_.SaveIndex("missing_directory/index"));
+  ASSERT_TRUE(sga::SequenceGraph<>::IsIndexFile(index_file_path));
+  ASSERT_FALSE(
+      sga::SequenceGraph<>::IsIndexFile(gfa_sequence_graph_file_path_));
+  sga::SequenceGraph<> index_sequence_graph;
+  ASSERT_TRUE(index_sequence_graph.LoadIndex(index_file_path));
+
+  // A truncated index and one whose header counts overflow the sections are
+  // rejected.
+  std::ifstream index_stream(index_file_path, std::ios::binary);
+  const std::string index((std::istreambuf_iterator<char>(index_stream)),
+                          std::istreambuf_iterator<char>());
+  std::remove(index_file_path.c_str());
+  const std::string corrupt_index_file_path = "corrupt_index.sgaidx";
+  std::ofstream(corrupt_index_file_path, std::ios::binary)
+      << index.substr(0, index.size() / 2);
+  sga::SequenceGraph<> truncated_index_sequence_graph;
+  EXPECT_FALSE(truncated_index_sequence_graph.LoadIndex(
+      corrupt_index_file_path));
+  for (const uint64_t num_explicit_edges :
+       {(uint64_t)-1, (uint64_t)index.size()}) {
+    std::string corrupt_index = index;
+    memcpy(&corrupt_index[offsetof(sga::SequenceGraphIndexHeader,
+                                   num_explicit_edges)],
+           &num_explicit_edges, sizeof(num_explicit_edges));
+    std::ofstream(corrupt_index_file_path, std::ios::binary) << corrupt_index;
+    sga::SequenceGraph<> corrupt_index_sequence_graph;
+    EXPECT_FALSE(corrupt_index_sequence_graph.LoadIndex(
+        corrupt_index_file_path));
+  }
+  std::remove(corrupt_index_file_path.c_str());
+
+  EXPECT_EQ(index_sequence_graph.GetNumVertices(),
+            gfa_sequence_graph_.GetNumVertices());
+  EXPECT_EQ(index_sequence_graph.GetNumEdges(),
+            gfa_sequence_graph_.GetNumEdges());
+  EXPECT_EQ(index_sequence_graph.GetNumVerticesInCompactedGraph(),
+            gfa_sequence_graph_.GetNumVerticesInCompactedGraph());
+  EXPECT_EQ(index_sequence_graph.GetNumEdgesInCompactedGraph(),
+            gfa_sequence_graph_.GetNumEdgesInCompactedGraph());
+  EXPECT_EQ(index_sequence_graph.IsAcyclic(), gfa_sequence_graph_.IsAcyclic());
+  for (int32_t i = 0; i < gfa_sequence_graph_.GetNumVertices(); ++i) {
+    ASSERT_EQ(index_sequence_graph.GetVertexLabel(i),
+              gfa_sequence_graph_.GetVertexLabel(i));
+  }
+
+  // Align the shortest read on the index.
+  sequence_batch_.LoadBatch();
+  index_sequence_graph.SetAlignmentParameters(1, 1, 1);
+  const int32_t alignment_score =
+      index_sequence_graph.AlignUsingLinearGapPenaltyWithNavarroAlgorithm(
+          sequence_batch_.GetSequence(3));
+  EXPECT_EQ(alignment_score, 9)
+      << "Alignment score for sequence 3 is wrong! It should be 9 but it is "
+      << alignment_score;
+}
+
+TEST_F(SequenceGraphTest, PackedLabelsTest) {
+  // Long enough to cover full and partial mask words, with exceptions.
+  std::string labels;
+  const std::string alphabet = "ACGTNACGTaRACGT";
+  for (uint32_t i = 0; i < 150; ++i) {
+    labels.push_back(alphabet[(i * 7) % alphabet.size()]);
+  }
+  sga::PackedLabels packed_labels;
+  packed_labels.Build(labels.data(), labels.size());
+  std::vector<uint64_t> mismatch_mask(packed_labels.GetNumMaskWords());
+  std::vector<int16_t> row(labels.size());
+  std::vector<int32_t> wide_row(labels.size());
+  // The sets not supported by the CPU are lowered to the supported ones.
+  for (const sga::InstructionSet instruction_set :
+       {sga::InstructionSet::kBaseline, sga::InstructionSet::kAvx2}) {
+    packed_labels.SetInstructionSet(instruction_set);
+    for (const char base : std::string("ACGTNa")) {
+      packed_labels.InitializeRow(base, (int16_t)5, (int16_t)3,
+                                  mismatch_mask.data(), row.data());
+      packed_labels.InitializeRow(base, 7, 2, mismatch_mask.data(),
+                                  wide_row.data());
+      for (uint32_t i = 0; i < labels.size(); ++i) {
+        const bool is_mismatch = base != labels[i];
+        EXPECT_EQ(sga::PackedLabels::IsMismatch(mismatch_mask.data(), i),
+                  is_mismatch)
+            << "Mismatch of base " << base << " and label " << i
+            << " is wrong with " << sga::GetInstructionSetName(instruction_set);
+        EXPECT_EQ(row[i], is_mismatch ? 8 : 5)
+            << "Cost of base " << base << " and label " << i
+            << " is wrong with " << sga::GetInstructionSetName(instruction_set);
+        EXPECT_EQ(wide_row[i], is_mismatch ? 9 : 7)
+            << "Cost of base " << base << " and label " << i
+            << " is wrong with " << sga::GetInstructionSetName(instruction_set);
+      }
+      // The mask can also be computed a word at a time, with no bit set past
+      // the last label.
+      for (size_t wi = 0; wi < mismatch_mask.size(); ++wi) {
+        EXPECT_EQ(packed_labels.GetMismatchWord(base, wi), mismatch_mask[wi]);
+      }
+      EXPECT_EQ(mismatch_mask.back() >> (labels.size() & 63), (uint64_t)0);
+    }
+  }
+}
+
 TEST_F(SequenceGraphTest, AlignUsingLinearGapPenaltyTest) {
   const uint32_t num_loaded_sequences = sequence_batch_.LoadBatch();
   const int32_t max_alignment_scores[5] = {62, 25, 54, 9, 37};
@@ -109,6 +319,31 @@ TEST_F(SequenceGraphTest, AlignUsingLinearGapPenaltyWithNavarroAlgorithmTest) {
   }
 }
 
+TEST_F(SequenceGraphTest,
+       AlignUsingLinearGapPenaltyWithNavarroAlgorithmWithoutComponentSweepTest) {
+  const uint32_t num_loaded_sequences = sequence_batch_.LoadBatch();
+  const int32_t max_alignment_scores[5] = {62, 25, 54, 9, 37};
+  txt_sequence_graph_.SetAlignmentParameters(1, 1, 1);
+  // The insertions are propagated with the bucket queue instead of the sweep.
+  txt_sequence_graph_.SetComponentSweep(false);
+  for (uint32_t i = 0; i < num_loaded_sequences; ++i) {
+    const int32_t alignment_score =
+        txt_sequence_graph_.AlignUsingLinearGapPenaltyWithNavarroAlgorithm(
+            sequence_batch_.GetSequence(i));
+    EXPECT_EQ(alignment_score, max_alignment_scores[i])
+        << "Alignment score for sequence" << i << " is wrong! It should be "
+        << max_alignment_scores[i] << " but it is " << alignment_score;
+  }
+  txt_sequence_graph_.SetAlignmentParameters(1, 2, 3);
+  for (uint32_t i = 0; i < num_loaded_sequences; ++i) {
+    const sga::Sequence sequence = sequence_batch_.GetSequence(i);
+    EXPECT_EQ(
+        txt_sequence_graph_.AlignUsingLinearGapPenaltyWithNavarroAlgorithm(
+            sequence),
+        txt_sequence_graph_.AlignUsingLinearGapPenalty(sequence));
+  }
+}
+
 TEST_F(SequenceGraphTest, AlignUsingLinearGapPenaltyWithNavarroAlgorithmOnGfaGraphTest) {
   const uint32_t num_loaded_sequences = sequence_batch_.LoadBatch();
   const int32_t max_alignment_scores[5] = {62, 25, 54, 9, 37};
@@ -123,6 +358,348 @@ TEST_F(SequenceGraphTest, AlignUsingLinearGapPenaltyWithNavarroAlgorithmOnGfaGra
   }
 }
 
+TEST_F(SequenceGraphTest, AlignUsingLinearGapPenaltyWithMyersAlgorithmTest) {
+  const uint32_t num_loaded_sequences = sequence_batch_.LoadBatch();
+  const int32_t max_alignment_scores[5] = {62, 25, 54, 9, 37};
+  txt_sequence_graph_.SetAlignmentParameters(1, 1, 1);
+  for (uint32_t i = 0; i < num_loaded_sequences; ++i) {
+    const int32_t alignment_score =
+        txt_sequence_graph_.AlignUsingLinearGapPenaltyWithMyersAlgorithm(
+            sequence_batch_.GetSequence(i));
+    EXPECT_EQ(alignment_score, max_alignment_scores[i])
+        << "Alignment score for sequence" << i << " is wrong! It should be "
+        << max_alignment_scores[i] << " but it is " << alignment_score;
+  }
+}
+
+TEST_F(SequenceGraphTest, MergeMyersColumnsTest) {
+  // Random columns of 3 blocks whose distances change by at most 1 per row,
+  // with walks that cross often and walks that stay apart.
+  const size_t num_blocks = 3;
+  auto encode = [](const std::vector<int> &distances, uint64_t *column) {
+    std::fill(column, column + 2 * num_blocks, 0);
+    for (size_t i = 0; i < distances.size(); ++i) {
+      const int previous_distance = i == 0 ? 0 : distances[i - 1];
+      const uint64_t bit = (uint64_t)1 << (i & 63);
+      if (distances[i] > previous_distance) {
+        column[(i >> 6) << 1] |= bit;
+      } else if (distances[i] < previous_distance) {
+        column[((i >> 6) << 1) + 1] |= bit;
+      }
+    }
+  };
+  std::mt19937 generator(7);
+  std::uniform_int_distribution<int> step(-1, 1);
+  for (int ti = 0; ti < 1000; ++ti) {
+    std::vector<int> candidate_distances(64 * num_blocks);
+    std::vector<int> distances(64 * num_blocks);
+    // The bias of the second walk is 0 or 1, so the walks drift apart.
+    const int bias = ti % 2;
+    int candidate_distance = 0;
+    int distance = 0;
+    for (size_t i = 0; i < distances.size(); ++i) {
+      candidate_distance += step(generator);
+      distance += std::min(1, step(generator) + bias);
+      candidate_distances[i] = candidate_distance;
+      distances[i] = distance;
+    }
+    uint64_t candidate_column[2 * num_blocks];
+    uint64_t column[2 * num_blocks];
+    uint64_t min_column[2 * num_blocks];
+    encode(candidate_distances, candidate_column);
+    encode(distances, column);
+    std::vector<int> min_distances(distances.size());
+    for (size_t i = 0; i < distances.size(); ++i) {
+      min_distances[i] = std::min(candidate_distances[i], distances[i]);
+    }
+    encode(min_distances, min_column);
+    const bool is_changed = min_distances != distances;
+    EXPECT_EQ(sga::SequenceGraph<>::MergeMyersColumns(candidate_column,
+                                                      num_blocks, column),
+              is_changed);
+    EXPECT_TRUE(std::equal(column, column + 2 * num_blocks, min_column));
+  }
+}
+
+TEST_F(SequenceGraphTest, AlignUsingLinearGapPenaltyWithMyersAlgorithmOnCyclicGraphTest) {
+  sga::SequenceGraph<> cyclic_sequence_graph;
+  cyclic_sequence_graph.LoadFromTxtFile("cyclic_seq_graph.txt");
+  cyclic_sequence_graph.GenerateCharLabeledGraph();
+  cyclic_sequence_graph.GenerateCompressedRepresentation();
+  cyclic_sequence_graph.SetAlignmentParameters(1, 1, 1);
+  ASSERT_FALSE(cyclic_sequence_graph.IsAcyclic());
+
+  // Sequences spelled along the back edges and the self loop of the graph, the
+  // last one with a substitution and a deletion.
+  const std::string sequences[3] = {
+      "GGTCGCGAGGGAAGCGCTGAGGATCAGGAAGGGGGCACTGGACAGGCTGTGGGGTTTCTCAGATAACTG"
+      "G",
+      "GATGCTCTGGGGTACTGGCGTGGGAGAGTGAAGGTAGTAGAGTCCCGGGAAAGGGACAGGGGGCCCAAGT"
+      "GATGCTCTGGGGTACTGGCGTGGGAGAGTGGATTTCCGAAGCTGACAGAT",
+      "TGAAACTCCGTCTCTACTAAGTACCTTGATTTCGTATTCTGAGAGTGCTGCTTAGCGG"};
+  const int32_t max_alignment_scores[3] = {0, 0, 3};
+  for (uint32_t i = 0; i < 3; ++i) {
+    const sga::Sequence sequence(sequences[i].length(), "",
+                                 sequences[i].c_str());
+    const int32_t alignment_score =
+        cyclic_sequence_graph.AlignUsingLinearGapPenaltyWithMyersAlgorithm(
+            sequence);
+    EXPECT_LE(alignment_score, max_alignment_scores[i]);
+    EXPECT_EQ(alignment_score,
+              cyclic_sequence_graph
+                  .AlignUsingLinearGapPenaltyWithNavarroAlgorithm(sequence));
+  }
+
+  const uint32_t num_loaded_sequences = sequence_batch_.LoadBatch();
+  for (uint32_t i = 0; i < num_loaded_sequences; ++i) {
+    EXPECT_EQ(
+        cyclic_sequence_graph.AlignUsingLinearGapPenaltyWithMyersAlgorithm(
+            sequence_batch_.GetSequence(i)),
+        cyclic_sequence_graph.AlignUsingLinearGapPenaltyWithNavarroAlgorithm(
+            sequence_batch_.GetSequence(i)));
+  }
+}
+
+TEST_F(SequenceGraphTest, ComponentSweepOnCyclicGraphTest) {
+  sga::SequenceGraph<> cyclic_sequence_graph;
+  cyclic_sequence_graph.LoadFromTxtFile("cyclic_seq_graph.txt");
+  cyclic_sequence_graph.GenerateCharLabeledGraph();
+  cyclic_sequence_graph.GenerateCompressedRepresentation();
+  cyclic_sequence_graph.SetAlignmentParameters(1, 2, 3);
+  ASSERT_FALSE(cyclic_sequence_graph.IsAcyclic());
+  // The cyclic components are mapped from the index.
+  const std::string index_file_path = "cyclic_seq_graph_test.sgaidx";
+  ASSERT_TRUE(cyclic_sequence_graph.SaveIndex(index_file_path));
+  sga::SequenceGraph<> index_sequence_graph;
+  ASSERT_TRUE(index_sequence_graph.LoadIndex(index_file_path));
+  std::remove(index_file_path.c_str());
+  ASSERT_FALSE(index_sequence_graph.IsAcyclic());
+  index_sequence_graph.SetAlignmentParameters(1, 2, 3);
+
+  const uint32_t num_loaded_sequences = sequence_batch_.LoadBatch();
+  for (uint32_t i = 0; i < num_loaded_sequences; ++i) {
+    const sga::Sequence sequence = sequence_batch_.GetSequence(i);
+    EXPECT_EQ(
+        index_sequence_graph.AlignUsingLinearGapPenaltyWithNavarroAlgorithm(
+            sequence),
+        cyclic_sequence_graph.AlignUsingLinearGapPenaltyWithNavarroAlgorithm(
+            sequence));
+    cyclic_sequence_graph.SetComponentSweep(false);
+    const int16_t recomb_alignment_score =
+        cyclic_sequence_graph.AlignUsingLinearGapPenalty(sequence);
+    const int16_t navarro_alignment_score =
+        cyclic_sequence_graph.AlignUsingLinearGapPenaltyWithNavarroAlgorithm(
+            sequence);
+    cyclic_sequence_graph.SetComponentSweep(true);
+    EXPECT_EQ(cyclic_sequence_graph.AlignUsingLinearGapPenalty(sequence),
+              recomb_alignment_score);
+    EXPECT_EQ(
+        cyclic_sequence_graph.AlignUsingLinearGapPenaltyWithNavarroAlgorithm(
+            sequence),
+        navarro_alignment_score);
+  }
+}
+
+TEST_F(SequenceGraphTest, AlignWithMaxCostTest) {
+  const uint32_t num_loaded_sequences = sequence_batch_.LoadBatch();
+  const int32_t max_alignment_scores[5] = {62, 25, 54, 9, 37};
+  txt_sequence_graph_.SetAlignmentParameters(1, 1, 1);
+  for (uint32_t i = 0; i < num_loaded_sequences; ++i) {
+    const sga::Sequence sequence = sequence_batch_.GetSequence(i);
+    const int16_t max_alignment_score = max_alignment_scores[i];
+    // The cost is exact when it is not above the bound.
+    EXPECT_EQ(txt_sequence_graph_.AlignUsingLinearGapPenalty(
+                  sequence, max_alignment_score),
+        max_alignment_score);
+    EXPECT_EQ(
+        txt_sequence_graph_.AlignUsingLinearGapPenaltyWithNavarroAlgorithm(
+            sequence, max_alignment_score),
+        max_alignment_score);
+    EXPECT_EQ(txt_sequence_graph_.AlignUsingLinearGapPenaltyOnCompactedGraph(
+                  sequence, max_alignment_score),
+              max_alignment_score);
+    // Otherwise the alignment stops early with a cost above the bound.
+    EXPECT_GT(txt_sequence_graph_.AlignUsingLinearGapPenalty(
+                  sequence, max_alignment_score / 2),
+        max_alignment_score / 2);
+    EXPECT_GT(
+        txt_sequence_graph_.AlignUsingLinearGapPenaltyWithNavarroAlgorithm(
+            sequence, max_alignment_score / 2),
+        max_alignment_score / 2);
+    EXPECT_GT(txt_sequence_graph_.AlignUsingLinearGapPenaltyOnCompactedGraph(
+                  sequence, max_alignment_score / 2),
+              max_alignment_score / 2);
+  }
+
+  // The Dijkstra aligner stops as soon as its queue min is above the bound.
+  EXPECT_EQ(txt_sequence_graph_.AlignUsingLinearGapPenaltyWithDijkstraAlgorithm(
+                sequence_batch_.GetSequence(3), 4),
+            5);
+}
+
+TEST_F(SequenceGraphTest, AlignUsingLinearGapPenaltyWithActiveSetTest) {
+  const uint32_t num_loaded_sequences = sequence_batch_.LoadBatch();
+  const int32_t max_alignment_scores[5] = {62, 25, 54, 9, 37};
+  txt_sequence_graph_.SetAlignmentParameters(1, 1, 1);
+  for (uint32_t i = 0; i < num_loaded_sequences; ++i) {
+    const sga::Sequence sequence = sequence_batch_.GetSequence(i);
+    const int16_t max_alignment_score = max_alignment_scores[i];
+    EXPECT_EQ(txt_sequence_graph_.AlignUsingLinearGapPenaltyWithActiveSet(
+                  sequence, max_alignment_score),
+              max_alignment_score);
+    EXPECT_EQ(txt_sequence_graph_.AlignUsingLinearGapPenaltyWithActiveSet(
+                  sequence, max_alignment_score - 1),
+              max_alignment_score);
+  }
+
+  sga::SequenceGraph<> cyclic_sequence_graph;
+  cyclic_sequence_graph.LoadFromTxtFile("cyclic_seq_graph.txt");
+  cyclic_sequence_graph.GenerateCharLabeledGraph();
+  cyclic_sequence_graph.GenerateCompressedRepresentation();
+  cyclic_sequence_graph.SetAlignmentParameters(1, 2, 3);
+  for (uint32_t i = 0; i < num_loaded_sequences; ++i) {
+    const sga::Sequence sequence = sequence_batch_.GetSequence(i);
+    EXPECT_EQ(
+        cyclic_sequence_graph.AlignUsingLinearGapPenaltyWithActiveSet(
+            sequence, 1000),
+        cyclic_sequence_graph.AlignUsingLinearGapPenaltyWithNavarroAlgorithm(
+            sequence));
+  }
+
+  // Deletions cheaper than substitutions, so that the first row is seeded
+  // with the deletions from row -1, and bounds around the costs.
+  cyclic_sequence_graph.SetAlignmentParameters(3, 1, 2);
+  for (uint32_t i = 0; i < num_loaded_sequences; ++i) {
+    const sga::Sequence sequence = sequence_batch_.GetSequence(i);
+    const int16_t alignment_score =
+        cyclic_sequence_graph.AlignUsingLinearGapPenaltyWithNavarroAlgorithm(
+            sequence);
+    for (const int16_t max_cost :
+         {(int16_t)0, (int16_t)2, (int16_t)(alignment_score - 1),
+          alignment_score, (int16_t)1000}) {
+      EXPECT_EQ(cyclic_sequence_graph.AlignUsingLinearGapPenaltyWithActiveSet(
+                    sequence, max_cost),
+                std::min<int16_t>(alignment_score, max_cost + 1));
+    }
+  }
+}
+
+TEST_F(SequenceGraphTest, AlignOnBidirectedGraphTest) {
+  const uint32_t num_loaded_sequences = sequence_batch_.LoadBatch();
+  const int32_t max_alignment_scores[5] = {62, 25, 54, 9, 37};
+  sga::SequenceGraph<> bidirected_sequence_graph;
+  bidirected_sequence_graph.LoadFromTxtFile(txt_sequence_graph_file_path_);
+  bidirected_sequence_graph.GenerateCharLabeledGraph();
+  const int32_t num_forward_vertices =
+      bidirected_sequence_graph.GetNumVertices();
+  bidirected_sequence_graph.GenerateReverseComplementaryCharLabeledGraph();
+  bidirected_sequence_graph.GenerateCompressedRepresentation();
+  ASSERT_TRUE(bidirected_sequence_graph.IsBidirected());
+  ASSERT_EQ(bidirected_sequence_graph.GetNumVertices(),
+            2 * num_forward_vertices - 1);
+  int32_t num_reverse_complementary_vertices = 0;
+  for (int32_t vertex = 0; vertex < bidirected_sequence_graph.GetNumVertices();
+       ++vertex) {
+    num_reverse_complementary_vertices +=
+        bidirected_sequence_graph.IsReverseComplementaryVertex(vertex);
+  }
+  EXPECT_EQ(num_reverse_complementary_vertices, num_forward_vertices - 1);
+
+  bidirected_sequence_graph.SetAlignmentParameters(1, 1, 1);
+  for (uint32_t i = 0; i < num_loaded_sequences; ++i) {
+    const sga::Sequence sequence = sequence_batch_.GetSequence(i);
+    EXPECT_EQ(bidirected_sequence_graph.AlignUsingLinearGapPenalty(sequence),
+              max_alignment_scores[i]);
+    EXPECT_EQ(
+        bidirected_sequence_graph
+            .AlignUsingLinearGapPenaltyWithNavarroAlgorithm(sequence),
+        max_alignment_scores[i]);
+    EXPECT_EQ(bidirected_sequence_graph
+                  .AlignUsingLinearGapPenaltyWithMyersAlgorithm(sequence),
+              max_alignment_scores[i]);
+  }
+
+  bidirected_sequence_graph.SetAlignmentParameters(1, 2, 3);
+  txt_sequence_graph_.SetAlignmentParameters(1, 2, 3);
+  for (uint32_t i = 0; i < num_loaded_sequences; ++i) {
+    const sga::Sequence sequence = sequence_batch_.GetSequence(i);
+    EXPECT_EQ(bidirected_sequence_graph.AlignUsingLinearGapPenalty(sequence),
+              txt_sequence_graph_.AlignUsingLinearGapPenalty(sequence));
+  }
+}
+
+TEST_F(SequenceGraphTest, AlignUsingLinearGapPenaltyOnCompactedGraphTest) {
+  const uint32_t num_loaded_sequences = sequence_batch_.LoadBatch();
+  const int32_t max_alignment_scores[5] = {62, 25, 54, 9, 37};
+  sga::SequenceGraph<> compacted_sequence_graph;
+  compacted_sequence_graph.LoadFromTxtFile(txt_sequence_graph_file_path_);
+  compacted_sequence_graph.SetAlignmentParameters(1, 1, 1);
+  for (uint32_t i = 0; i < num_loaded_sequences; ++i) {
+    const int32_t alignment_score =
+        compacted_sequence_graph.AlignUsingLinearGapPenaltyOnCompactedGraph(
+            sequence_batch_.GetSequence(i));
+    EXPECT_EQ(alignment_score, max_alignment_scores[i])
+        << "Alignment score for sequence" << i << " is wrong! It should be "
+        << max_alignment_scores[i] << " but it is " << alignment_score;
+  }
+
+  sga::SequenceGraph<> cyclic_sequence_graph;
+  cyclic_sequence_graph.LoadFromTxtFile("cyclic_seq_graph.txt");
+  cyclic_sequence_graph.GenerateCharLabeledGraph();
+  cyclic_sequence_graph.GenerateCompressedRepresentation();
+  cyclic_sequence_graph.SetAlignmentParameters(1, 2, 3);
+  for (uint32_t i = 0; i < num_loaded_sequences; ++i) {
+    const sga::Sequence sequence = sequence_batch_.GetSequence(i);
+    const int16_t alignment_score =
+        cyclic_sequence_graph.AlignUsingLinearGapPenalty(sequence);
+    EXPECT_EQ(
+        cyclic_sequence_graph.AlignUsingLinearGapPenaltyOnCompactedGraph(
+            sequence),
+        alignment_score);
+    EXPECT_EQ(
+        cyclic_sequence_graph.AlignUsingLinearGapPenaltyOnCompactedGraph(
+            sequence, alignment_score),
+        alignment_score);
+    EXPECT_GT(
+        cyclic_sequence_graph.AlignUsingLinearGapPenaltyOnCompactedGraph(
+            sequence, alignment_score - 1),
+        alignment_score - 1);
+  }
+
+  // An index does not keep the compacted graph labels, so they are spelled
+  // from the chains of the char labeled graph.
+  const std::string index_file_path = "cyclic_seq_graph_test.sgaidx";
+  ASSERT_TRUE(cyclic_sequence_graph.SaveIndex(index_file_path));
+  sga::SequenceGraph<> index_sequence_graph;
+  ASSERT_TRUE(index_sequence_graph.LoadIndex(index_file_path));
+  std::remove(index_file_path.c_str());
+  index_sequence_graph.SetAlignmentParameters(1, 2, 3);
+  for (uint32_t i = 0; i < num_loaded_sequences; ++i) {
+    const sga::Sequence sequence = sequence_batch_.GetSequence(i);
+    EXPECT_EQ(
+        index_sequence_graph.AlignUsingLinearGapPenaltyOnCompactedGraph(
+            sequence),
+        cyclic_sequence_graph.AlignUsingLinearGapPenaltyOnCompactedGraph(
+            sequence));
+  }
+
+  // The compacted graph of a bidirected graph only has the forward strand,
+  // and the reverse complement of the sequence is aligned to it instead.
+  sga::SequenceGraph<> bidirected_sequence_graph;
+  bidirected_sequence_graph.LoadFromTxtFile(txt_sequence_graph_file_path_);
+  bidirected_sequence_graph.GenerateCharLabeledGraph();
+  bidirected_sequence_graph.GenerateReverseComplementaryCharLabeledGraph();
+  bidirected_sequence_graph.GenerateCompressedRepresentation();
+  bidirected_sequence_graph.SetAlignmentParameters(1, 1, 1);
+  for (uint32_t i = 0; i < num_loaded_sequences; ++i) {
+    const sga::Sequence sequence = sequence_batch_.GetSequence(i);
+    EXPECT_EQ(
+        bidirected_sequence_graph.AlignUsingLinearGapPenaltyOnCompactedGraph(
+            sequence),
+        max_alignment_scores[i]);
+  }
+}
+
 TEST_F(SequenceGraphTest, AlignUsingLinearGapPenaltyWithDijkstraAlgorithmTest) {
   const uint32_t num_loaded_sequences = sequence_batch_.LoadBatch();
   const int32_t max_alignment_scores[5] = {62, 25, 54, 9, 37};
@@ -136,6 +713,34 @@ TEST_F(SequenceGraphTest, AlignUsingLinearGapPenaltyWithDijkstraAlgorithmTest) {
         << max_alignment_scores[i] << " but it is " << alignment_score;
   }
 }
+
+TEST_F(SequenceGraphTest, AlignBatchWithNavarroAlgorithmTest) {
+  const uint32_t num_loaded_sequences = sequence_batch_.LoadBatch();
+  const int32_t max_alignment_scores[5] = {62, 25, 54, 9, 37};
+  txt_sequence_graph_.SetAlignmentParameters(1, 1, 1);
+  sga::BatchAligner<sga::SequenceGraph<>> batch_aligner(txt_sequence_graph_,
+                                                        /*num_threads=*/3);
+  // The threads are reused across batches and restarted with a new count,
+  // here larger than the batch.
+  for (const int num_threads : {3, 3, 8}) {
+    batch_aligner.SetNumThreads(num_threads);
+    std::vector<int16_t> alignment_scores;
+    batch_aligner.AlignBatch(
+        sequence_batch_,
+        [](const sga::SequenceGraph<> &graph, const sga::Sequence &sequence,
+           sga::SequenceGraph<>::Workspace &workspace) {
+          return graph.AlignUsingLinearGapPenaltyWithNavarroAlgorithm(
+              sequence, workspace);
+        },
+        alignment_scores);
+    ASSERT_EQ(alignment_scores.size(), num_loaded_sequences);
+    for (uint32_t i = 0; i < num_loaded_sequences; ++i) {
+      EXPECT_EQ(alignment_scores[i], max_alignment_scores[i])
+          << "Alignment score for sequence" << i << " is wrong! It should be "
+          << max_alignment_scores[i] << " but it is " << alignment_scores[i];
+    }
+  }
+}
 }  // namespace sga_testing
 
 int main(int argc, char **argv) {
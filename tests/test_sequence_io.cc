@@ -1,6 +1,12 @@
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
 #include "gtest/gtest.h"
 #include "sequence.h"
 #include "sequence_batch.h"
+#include "sequence_input_stream.h"
 
 namespace sga_testing {
 
@@ -57,6 +63,143 @@ TEST_F(SequenceBatchTest, LoadBatchTest) {
                true_sequence.GetSequence().c_str());
 }
 
+TEST_F(SequenceBatchTest, LoadBatchAsynchronouslyTest) {
+  sga::SequenceBatch sequence_batch(2);
+  sequence_batch.InitializeLoading(sequence_file_path_,
+                                   /*load_asynchronously=*/true);
+  const uint32_t true_num_loaded_sequences[4] = {2, 2, 1, 0};
+  for (uint32_t bi = 0; bi < 4; ++bi) {
+    const uint32_t num_loaded_sequences = sequence_batch.LoadBatch();
+    ASSERT_EQ(num_loaded_sequences, true_num_loaded_sequences[bi])
+        << "Number of sequences loaded in batch " << bi
+        << " is wrong! It should be " << true_num_loaded_sequences[bi]
+        << " but it is " << num_loaded_sequences;
+    // Both loading modes should produce the same batches.
+    ASSERT_EQ(sequence_batch_.LoadBatch(), num_loaded_sequences);
+    for (uint32_t si = 0; si < num_loaded_sequences; ++si) {
+      ASSERT_STREQ(sequence_batch.GetSequence(si).GetName().c_str(),
+                   sequence_batch_.GetSequence(si).GetName().c_str());
+      ASSERT_STREQ(sequence_batch.GetSequence(si).GetSequence().c_str(),
+                   sequence_batch_.GetSequence(si).GetSequence().c_str());
+    }
+  }
+  // The waits are only added up, not reported.
+  EXPECT_GE(sequence_batch.GetPrefetchWaitTime(), 0);
+  EXPECT_EQ(sequence_batch_.GetPrefetchWaitTime(), 0);
+
+  // Initializing the loading again while a batch is being prefetched starts
+  // over from the first batch.
+  sequence_batch.InitializeLoading(sequence_file_path_,
+                                   /*load_asynchronously=*/true);
+  ASSERT_EQ(sequence_batch.LoadBatch(), (uint32_t)2);
+  const std::string first_sequence_name =
+      sequence_batch.GetSequence(0).GetName().ToString();
+  sequence_batch.InitializeLoading(sequence_file_path_,
+                                   /*load_asynchronously=*/true);
+  ASSERT_EQ(sequence_batch.LoadBatch(), (uint32_t)2);
+  EXPECT_EQ(sequence_batch.GetSequence(0).GetName().ToString(),
+            first_sequence_name);
+  sequence_batch.FinalizeLoading();
+}
+
+TEST_F(SequenceBatchTest, LoadCompressedBatchTest) {
+  const std::string compressed_sequence_file_paths[2] = {
+      "BRCA1_5_reads.fastq.gz", "BRCA1_5_reads.fastq.bgz"};
+  for (const std::string &compressed_sequence_file_path :
+       compressed_sequence_file_paths) {
+    sga::SequenceBatch plain_sequence_batch(5);
+    plain_sequence_batch.InitializeLoading(sequence_file_path_);
+    ASSERT_EQ(plain_sequence_batch.LoadBatch(), (uint32_t)5);
+
+    sga::SequenceBatch sequence_batch(5);
+    sequence_batch.InitializeLoading(compressed_sequence_file_path,
+                                     /*load_asynchronously=*/false,
+                                     /*num_decompression_threads=*/2);
+    const uint32_t num_loaded_sequences = sequence_batch.LoadBatch();
+    ASSERT_EQ(num_loaded_sequences, (uint32_t)5)
+        << "Number of sequences loaded from " << compressed_sequence_file_path
+        << " is wrong! It should be 5 but it is " << num_loaded_sequences;
+    for (uint32_t si = 0; si < num_loaded_sequences; ++si) {
+      ASSERT_STREQ(sequence_batch.GetSequence(si).GetName().c_str(),
+                   plain_sequence_batch.GetSequence(si).GetName().c_str());
+      ASSERT_STREQ(sequence_batch.GetSequence(si).GetSequence().c_str(),
+                   plain_sequence_batch.GetSequence(si).GetSequence().c_str());
+      ASSERT_STREQ(
+          sequence_batch.GetSequence(si).GetQualityScores().c_str(),
+          plain_sequence_batch.GetSequence(si).GetQualityScores().c_str());
+    }
+    ASSERT_EQ(sequence_batch.LoadBatch(), (uint32_t)0);
+    sequence_batch.FinalizeLoading();
+    plain_sequence_batch.FinalizeLoading();
+  }
+}
+
+TEST_F(SequenceBatchTest, ReopenInputStreamTest) {
+  std::ifstream plain_file(sequence_file_path_, std::ios::binary);
+  const std::string plain_bytes((std::istreambuf_iterator<char>(plain_file)),
+                                std::istreambuf_iterator<char>());
+  auto read_all = [](sga::SequenceInputStream &stream) {
+    std::string bytes;
+    char buffer[4096];
+    int num_bytes = 0;
+    while ((num_bytes = stream.Read(buffer, sizeof(buffer))) > 0) {
+      bytes.append(buffer, num_bytes);
+    }
+    EXPECT_EQ(num_bytes, 0);
+    return bytes;
+  };
+
+  // A BGZF file made mostly of empty blocks, which are skipped in a loop.
+  std::ifstream bgzf_file("BRCA1_5_reads.fastq.bgz", std::ios::binary);
+  const std::string bgzf_bytes((std::istreambuf_iterator<char>(bgzf_file)),
+                               std::istreambuf_iterator<char>());
+  const std::string empty_block = bgzf_bytes.substr(bgzf_bytes.size() - 28);
+  const std::string empty_blocks_file_path = "empty_blocks_reads.fastq.bgz";
+  {
+    std::ofstream empty_blocks_file(empty_blocks_file_path, std::ios::binary);
+    for (uint32_t i = 0; i < 100000; ++i) {
+      empty_blocks_file << empty_block;
+    }
+    empty_blocks_file << bgzf_bytes;
+  }
+
+  // The stream is reopened on files of each kind, with the previous file
+  // closed every time.
+  sga::SequenceInputStream stream;
+  for (const std::string &file_path :
+       {std::string("BRCA1_5_reads.fastq.bgz"), empty_blocks_file_path,
+        std::string("BRCA1_5_reads.fastq.gz"),
+        std::string("BRCA1_5_reads.fastq.bgz"), sequence_file_path_}) {
+    ASSERT_TRUE(stream.Open(file_path, /*num_decompression_threads=*/2));
+    EXPECT_EQ(stream.IsBgzf(), file_path.find(".bgz") != std::string::npos);
+    EXPECT_EQ(read_all(stream), plain_bytes) << file_path;
+  }
+  stream.Close();
+  remove(empty_blocks_file_path.c_str());
+}
+
+TEST_F(SequenceBatchTest, LoadCorruptBatchTest) {
+  sga::SequenceBatch sequence_batch(5);
+  ASSERT_FALSE(sequence_batch.InitializeLoading("missing_reads.fastq"));
+  ASSERT_EQ(sequence_batch.LoadBatch(), (uint32_t)0);
+  sequence_batch.FinalizeLoading();
+
+  // A BGZF file cut in the middle of its first block.
+  std::ifstream bgzf_file("BRCA1_5_reads.fastq.bgz", std::ios::binary);
+  const std::string bgzf_bytes((std::istreambuf_iterator<char>(bgzf_file)),
+                               std::istreambuf_iterator<char>());
+  const std::string truncated_file_path = "truncated_reads.fastq.bgz";
+  {
+    std::ofstream truncated_file(truncated_file_path, std::ios::binary);
+    truncated_file.write(bgzf_bytes.data(), bgzf_bytes.size() / 2);
+  }
+  sga::SequenceBatch truncated_sequence_batch(5);
+  ASSERT_TRUE(truncated_sequence_batch.InitializeLoading(truncated_file_path));
+  EXPECT_EQ(truncated_sequence_batch.LoadBatch(), (uint32_t)0);
+  truncated_sequence_batch.FinalizeLoading();
+  remove(truncated_file_path.c_str());
+}
+
 }  // namespace sga_testing
 
 int main(int argc, char **argv) {